@@ -0,0 +1,112 @@
+#include "AnimatedTexture.h"
+
+AnimatedTexture::AnimatedTexture(const char* gifPath, unsigned int ringSize)
+	: width(0), height(0), frames(NULL), currentIndex(0), framesSinceRewind(0), remainingMs(0.0)
+{
+	frames = stbi_gif_frames_open(gifPath, &width, &height);
+	if (!frames)
+	{
+		std::cout << "ERROR::ANIMATED_TEXTURE::FAILED_TO_OPEN " << gifPath << ": " << stbi_failure_reason() << std::endl;
+		return;
+	}
+	frameBuffer.resize((size_t)width * height * 4);
+
+	if (ringSize < 2)
+		ringSize = 2;
+	textures.resize(ringSize);
+	glCreateTextures(GL_TEXTURE_2D, ringSize, textures.data());
+	for (unsigned int i = 0; i < ringSize; i++)
+	{
+		glTextureStorage2D(textures[i], 1, GL_RGBA8, width, height);
+		glTextureParameteri(textures[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(textures[i], GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	// start on the last slot so the first frame lands in slot 0
+	currentIndex = ringSize - 1;
+	if (decodeNext())
+		upload();
+}
+
+void AnimatedTexture::update(double deltaSeconds)
+{
+	if (!frames)
+		return;
+
+	remainingMs -= deltaSeconds * 1000.0;
+	// skip frames rather than falling behind after a long stall; GIF frames build on the previous
+	// one, so skipped frames are still decoded, but only the last one is uploaded
+	bool decoded = false;
+	while (remainingMs <= 0.0)
+	{
+		if (!decodeNext())
+			return;
+		decoded = true;
+	}
+	if (decoded)
+		upload();
+}
+
+bool AnimatedTexture::decodeNext()
+{
+	int delay = 0;
+	int result = stbi_gif_frames_next(frames, frameBuffer.data(), &delay);
+	if (result == 0)
+	{
+		if (framesSinceRewind == 1)
+		{
+			// a still image: the frame already uploaded stays current, nothing to decode again
+			stbi_gif_frames_close(frames);
+			frames = NULL;
+			return false;
+		}
+		// end of animation: loop
+		stbi_gif_frames_rewind(frames);
+		framesSinceRewind = 0;
+		result = stbi_gif_frames_next(frames, frameBuffer.data(), &delay);
+	}
+	if (result != 1)
+	{
+		std::cout << "ERROR::ANIMATED_TEXTURE::DECODE_FAILED: " << stbi_failure_reason() << std::endl;
+		stbi_gif_frames_close(frames);
+		frames = NULL;
+		return false;
+	}
+
+	framesSinceRewind++;
+	// browsers treat delays of 0 or 1 (1/100 s) as 100 ms, do the same
+	remainingMs += delay <= 10 ? 100.0 : (double)delay;
+	return true;
+}
+
+void AnimatedTexture::upload()
+{
+	currentIndex = (currentIndex + 1) % textures.size();
+	glTextureSubImage2D(textures[currentIndex], 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frameBuffer.data());
+}
+
+unsigned int AnimatedTexture::current() const
+{
+	return textures.empty() ? 0 : textures[currentIndex];
+}
+
+bool AnimatedTexture::isValid() const
+{
+	return !textures.empty();
+}
+
+void AnimatedTexture::dispose()
+{
+	if (frames)
+	{
+		stbi_gif_frames_close(frames);
+		frames = NULL;
+	}
+	if (!textures.empty())
+	{
+		for (size_t i = 0; i < textures.size(); i++)
+			GLState::textureDeleted(textures[i]);
+		glDeleteTextures((GLsizei)textures.size(), textures.data());
+		textures.clear();
+	}
+}
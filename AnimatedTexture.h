@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <iostream>
+
+#include "stb_image.h"
+#include "GLState.h"
+
+// Plays an animated GIF with constant memory: frames are decoded one at a time
+// with stbi_gif_frames_next into a reusable buffer and uploaded round-robin into
+// a small ring of GL textures, so the frame being sampled is never the one being written.
+class AnimatedTexture
+{
+public:
+	int width, height;
+
+	AnimatedTexture(const char* gifPath, unsigned int ringSize = 3);
+	// advance playback, decoding and uploading the next frame once its delay has elapsed
+	void update(double deltaSeconds);
+	// texture holding the frame that should be sampled now
+	unsigned int current() const;
+	bool isValid() const;
+	void dispose();
+
+private:
+	stbi_gif_frames* frames;
+	std::vector<unsigned char> frameBuffer;
+	std::vector<unsigned int> textures;
+	unsigned int currentIndex;
+	int framesSinceRewind;
+	double remainingMs;
+
+	// decode the next frame (looping at the end) into frameBuffer and add its delay;
+	// false once playback has stopped, after an error or for a single-frame GIF
+	bool decodeNext();
+	// upload frameBuffer to the next ring slot and make it current
+	void upload();
+};
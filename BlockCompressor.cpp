@@ -0,0 +1,1246 @@
+#include "BlockCompressor.h"
+#include "Texture.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_SSE2
+#include <emmintrin.h>
+#endif
+
+// one 4x4 block as float channels (structure of arrays, so four pixels fit one SSE register), row-major pixel order
+struct ColorBlock
+{
+	float r[16], g[16], b[16], a[16];
+};
+
+// block rows per parallelFor chunk, 64 pixel rows
+static const size_t ROWS_PER_JOB = 16;
+
+static const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static const int ETC_MODIFIERS[8][2] = {
+	{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+};
+
+static const int EAC_MODIFIERS[16][8] = {
+	{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+	{ -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+	{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+	{ -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+	{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+	{ -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+	{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+	{ -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+};
+
+static inline int clampi(int v, int lo, int hi)
+{
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static inline float clampf(float v, float lo, float hi)
+{
+	return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static void loadBlock(const unsigned char* rgba, int width, int height, int bx, int by, ColorBlock& block)
+{
+	for (int y = 0; y < 4; y++)
+	{
+		// partial edge blocks repeat the last row/column
+		int sy = by * 4 + y < height ? by * 4 + y : height - 1;
+		for (int x = 0; x < 4; x++)
+		{
+			int sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+			const unsigned char* p = rgba + ((size_t)sy * width + sx) * 4;
+			int i = y * 4 + x;
+			block.r[i] = p[0];
+			block.g[i] = p[1];
+			block.b[i] = p[2];
+			block.a[i] = p[3];
+		}
+	}
+}
+
+// principal axis of the block's colors (power iteration on the covariance matrix), over the first `channels` channels
+static void principalAxis(const ColorBlock& block, int channels, float mean[4], float axis[4])
+{
+	const float* data[4] = { block.r, block.g, block.b, block.a };
+	float cov[4][4] = {};
+	for (int c = 0; c < 4; c++)
+	{
+		mean[c] = 0.0f;
+		axis[c] = 0.0f;
+	}
+	for (int c = 0; c < channels; c++)
+	{
+		for (int i = 0; i < 16; i++)
+			mean[c] += data[c][i];
+		mean[c] /= 16.0f;
+	}
+	for (int i = 0; i < 16; i++)
+		for (int j = 0; j < channels; j++)
+			for (int k = j; k < channels; k++)
+				cov[j][k] += (data[j][i] - mean[j]) * (data[k][i] - mean[k]);
+	for (int j = 0; j < channels; j++)
+		for (int k = 0; k < j; k++)
+			cov[j][k] = cov[k][j];
+
+	for (int c = 0; c < channels; c++)
+		axis[c] = 1.0f;
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float next[4] = {};
+		float length = 0.0f;
+		for (int j = 0; j < channels; j++)
+		{
+			for (int k = 0; k < channels; k++)
+				next[j] += cov[j][k] * axis[k];
+			length += next[j] * next[j];
+		}
+		if (length < 1e-12f)
+			return;  // flat block, keep the diagonal
+		length = 1.0f / sqrtf(length);
+		for (int j = 0; j < channels; j++)
+			axis[j] = next[j] * length;
+	}
+}
+
+// endpoints at the extreme projections of the block onto its principal axis
+static void axisEndpoints(const ColorBlock& block, int channels, float lo[4], float hi[4])
+{
+	const float* data[4] = { block.r, block.g, block.b, block.a };
+	float mean[4], axis[4];
+	principalAxis(block, channels, mean, axis);
+	float tMin = FLT_MAX, tMax = -FLT_MAX;
+	for (int i = 0; i < 16; i++)
+	{
+		float t = 0.0f;
+		for (int c = 0; c < channels; c++)
+			t += (data[c][i] - mean[c]) * axis[c];
+		tMin = t < tMin ? t : tMin;
+		tMax = t > tMax ? t : tMax;
+	}
+	for (int c = 0; c < 4; c++)
+	{
+		lo[c] = c < channels ? clampf(mean[c] + tMin * axis[c], 0.0f, 255.0f) : 255.0f;
+		hi[c] = c < channels ? clampf(mean[c] + tMax * axis[c], 0.0f, 255.0f) : 255.0f;
+	}
+}
+
+static void boundingBoxEndpoints(const ColorBlock& block, int channels, float lo[4], float hi[4])
+{
+	const float* data[4] = { block.r, block.g, block.b, block.a };
+	for (int c = 0; c < 4; c++)
+	{
+		lo[c] = 255.0f;
+		hi[c] = c < channels ? 0.0f : 255.0f;
+	}
+	for (int c = 0; c < channels; c++)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			lo[c] = data[c][i] < lo[c] ? data[c][i] : lo[c];
+			hi[c] = data[c][i] > hi[c] ? data[c][i] : hi[c];
+		}
+		// inset by 1/16 of the range, the interpolated points then cover the box better
+		float inset = (hi[c] - lo[c]) / 16.0f;
+		lo[c] += inset;
+		hi[c] -= inset;
+	}
+}
+
+// least squares endpoints for fixed per-pixel weights (weight of endpoint 0); returns false if degenerate
+static bool refineEndpoints(const ColorBlock& block, int channels, const float weights[16], const bool* skip,
+	float e0[4], float e1[4])
+{
+	const float* data[4] = { block.r, block.g, block.b, block.a };
+	float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[4] = {}, bx[4] = {};
+	for (int i = 0; i < 16; i++)
+	{
+		if (skip && skip[i])
+			continue;
+		float a = weights[i], b = 1.0f - weights[i];
+		aa += a * a;
+		bb += b * b;
+		ab += a * b;
+		for (int c = 0; c < channels; c++)
+		{
+			ax[c] += a * data[c][i];
+			bx[c] += b * data[c][i];
+		}
+	}
+	float det = aa * bb - ab * ab;
+	if (fabsf(det) < 1e-6f)
+		return false;
+	det = 1.0f / det;
+	for (int c = 0; c < channels; c++)
+	{
+		e0[c] = clampf((ax[c] * bb - bx[c] * ab) * det, 0.0f, 255.0f);
+		e1[c] = clampf((bx[c] * aa - ax[c] * ab) * det, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+// nearest palette color (RGB) for each pixel; returns the summed squared error
+static float selectColorIndices(const ColorBlock& block, const float palette[][4], int paletteSize, unsigned char indices[16])
+{
+	float error = 0.0f;
+#ifdef BC_SSE2
+	for (int i = 0; i < 16; i += 4)
+	{
+		__m128 r = _mm_loadu_ps(block.r + i);
+		__m128 g = _mm_loadu_ps(block.g + i);
+		__m128 b = _mm_loadu_ps(block.b + i);
+		__m128 best = _mm_set1_ps(FLT_MAX);
+		__m128i bestIndex = _mm_setzero_si128();
+		for (int p = 0; p < paletteSize; p++)
+		{
+			__m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[p][0]));
+			__m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[p][1]));
+			__m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[p][2]));
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+			__m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+			bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+			best = _mm_min_ps(d, best);
+		}
+		int lanes[4];
+		float errors[4];
+		_mm_storeu_si128((__m128i*)lanes, bestIndex);
+		_mm_storeu_ps(errors, best);
+		for (int k = 0; k < 4; k++)
+		{
+			indices[i + k] = (unsigned char)lanes[k];
+			error += errors[k];
+		}
+	}
+#else
+	for (int i = 0; i < 16; i++)
+	{
+		float best = FLT_MAX;
+		for (int p = 0; p < paletteSize; p++)
+		{
+			float dr = block.r[i] - palette[p][0], dg = block.g[i] - palette[p][1], db = block.b[i] - palette[p][2];
+			float d = dr * dr + dg * dg + db * db;
+			if (d < best)
+			{
+				best = d;
+				indices[i] = (unsigned char)p;
+			}
+		}
+		error += best;
+	}
+#endif
+	return error;
+}
+
+// ---------------------------------------------------------------------------------------------
+// BC1 / BC3 color
+
+static unsigned short pack565(const float c[4])
+{
+	int r = clampi((int)(c[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+	int g = clampi((int)(c[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+	int b = clampi((int)(c[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+	return (unsigned short)((r << 11) | (g << 5) | b);
+}
+
+static void unpack565(unsigned short v, int c[3])
+{
+	int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (r << 3) | (r >> 2);
+	c[1] = (g << 2) | (g >> 4);
+	c[2] = (b << 3) | (b >> 2);
+}
+
+static void colorPalette(unsigned short c0, unsigned short c1, bool fourColor, int palette[4][4])
+{
+	int a[3], b[3];
+	unpack565(c0, a);
+	unpack565(c1, b);
+	for (int c = 0; c < 3; c++)
+	{
+		palette[0][c] = a[c];
+		palette[1][c] = b[c];
+		palette[2][c] = fourColor ? (2 * a[c] + b[c]) / 3 : (a[c] + b[c]) / 2;
+		palette[3][c] = fourColor ? (a[c] + 2 * b[c]) / 3 : 0;
+	}
+	palette[0][3] = palette[1][3] = palette[2][3] = 255;
+	palette[3][3] = fourColor ? 255 : 0;
+}
+
+static void writeColorBlock(unsigned short c0, unsigned short c1, const unsigned char indices[16], unsigned char* out)
+{
+	unsigned int bits = 0;
+	for (int i = 0; i < 16; i++)
+		bits |= (unsigned int)(indices[i] & 3) << (i * 2);
+	out[0] = (unsigned char)c0;
+	out[1] = (unsigned char)(c0 >> 8);
+	out[2] = (unsigned char)c1;
+	out[3] = (unsigned char)(c1 >> 8);
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+// encode one endpoint pair; transparent pixels (BC1 punch-through) are forced to index 3 of the three-color palette
+static float encodeColorEndpoints(const ColorBlock& block, const bool* transparent, bool fourColor,
+	const float e0[4], const float e1[4], unsigned char* out, float weights[16])
+{
+	unsigned short c0 = pack565(e0), c1 = pack565(e1);
+	unsigned char indices[16] = {};
+	// four color mode is signalled by c0 > c1, three color mode by c0 <= c1
+	bool swapped = fourColor ? c0 < c1 : c0 > c1;
+	if (swapped)
+	{
+		unsigned short t = c0;
+		c0 = c1;
+		c1 = t;
+	}
+	if (fourColor && c0 == c1)
+	{
+		// equal endpoints would decode as three color mode; index 0 is exact
+		int color[3];
+		unpack565(c0, color);
+		float error = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			float dr = block.r[i] - color[0], dg = block.g[i] - color[1], db = block.b[i] - color[2];
+			error += dr * dr + dg * dg + db * db;
+			weights[i] = 1.0f;
+		}
+		writeColorBlock(c0, c1, indices, out);
+		return error;
+	}
+
+	int palette[4][4];
+	colorPalette(c0, c1, fourColor, palette);
+	float paletteF[4][4];
+	for (int p = 0; p < 4; p++)
+		for (int c = 0; c < 4; c++)
+			paletteF[p][c] = (float)palette[p][c];
+
+	float error = selectColorIndices(block, paletteF, fourColor ? 4 : 3, indices);
+	if (transparent)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			if (!transparent[i])
+				continue;
+			float dr = block.r[i] - paletteF[indices[i]][0], dg = block.g[i] - paletteF[indices[i]][1], db = block.b[i] - paletteF[indices[i]][2];
+			error -= dr * dr + dg * dg + db * db;
+			indices[i] = 3;
+		}
+	}
+
+	// weight of the first input endpoint for each pixel, for least squares refinement
+	const float fourWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+	const float threeWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		float w = fourColor ? fourWeights[indices[i]] : threeWeights[indices[i]];
+		weights[i] = swapped ? 1.0f - w : w;
+	}
+
+	writeColorBlock(c0, c1, indices, out);
+	return error;
+}
+
+static void encodeColor(const ColorBlock& block, bool allowPunchThrough, CompressionQuality quality, unsigned char* out)
+{
+	bool transparent[16];
+	int transparentCount = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		transparent[i] = allowPunchThrough && block.a[i] < 128.0f;
+		transparentCount += transparent[i];
+	}
+	if (transparentCount == 16)
+	{
+		// c0 <= c1 selects three color mode, index 3 is transparent black
+		const unsigned char clear[8] = { 0, 0, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF };
+		memcpy(out, clear, 8);
+		return;
+	}
+	bool fourColor = transparentCount == 0;
+
+	// endpoints are fitted to the opaque pixels only
+	ColorBlock opaque = block;
+	if (!fourColor)
+	{
+		int first = 0;
+		while (transparent[first])
+			first++;
+		for (int i = 0; i < 16; i++)
+		{
+			if (transparent[i])
+			{
+				opaque.r[i] = block.r[first];
+				opaque.g[i] = block.g[first];
+				opaque.b[i] = block.b[first];
+			}
+		}
+	}
+
+	float lo[4], hi[4];
+	float weights[16];
+	boundingBoxEndpoints(opaque, 3, lo, hi);
+	float bestError = encodeColorEndpoints(opaque, fourColor ? NULL : transparent, fourColor, hi, lo, out, weights);
+	if (quality == CompressionQuality::Fast)
+		return;
+
+	// the principal axis wins on gradients, the box on blocks with several distinct colors
+	unsigned char candidate[8];
+	float candidateWeights[16];
+	axisEndpoints(opaque, 3, lo, hi);
+	float axisError = encodeColorEndpoints(opaque, fourColor ? NULL : transparent, fourColor, hi, lo, candidate, candidateWeights);
+	if (axisError < bestError)
+	{
+		bestError = axisError;
+		memcpy(out, candidate, 8);
+		memcpy(weights, candidateWeights, sizeof(weights));
+	}
+	if (quality != CompressionQuality::High)
+		return;
+
+	for (int iteration = 0; iteration < 2; iteration++)
+	{
+		float e0[4], e1[4];
+		if (!refineEndpoints(opaque, 3, weights, fourColor ? NULL : transparent, e0, e1))
+			break;
+		float error = encodeColorEndpoints(opaque, fourColor ? NULL : transparent, fourColor, e0, e1, candidate, candidateWeights);
+		if (error >= bestError)
+			break;
+		bestError = error;
+		memcpy(out, candidate, 8);
+		memcpy(weights, candidateWeights, sizeof(weights));
+	}
+}
+
+static void decodeColor(const unsigned char* in, bool bc1, unsigned char pixels[16][4])
+{
+	unsigned short c0 = (unsigned short)(in[0] | (in[1] << 8));
+	unsigned short c1 = (unsigned short)(in[2] | (in[3] << 8));
+	unsigned int bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((unsigned int)in[7] << 24);
+	int palette[4][4];
+	// BC2/BC3 color blocks always use four colors
+	colorPalette(c0, c1, !bc1 || c0 > c1, palette);
+	for (int i = 0; i < 16; i++)
+	{
+		int index = (bits >> (i * 2)) & 3;
+		for (int c = 0; c < 4; c++)
+			pixels[i][c] = (unsigned char)palette[index][c];
+	}
+}
+
+// ---------------------------------------------------------------------------------------------
+// BC3 alpha
+
+static void alphaPalette(int a0, int a1, int palette[8])
+{
+	palette[0] = a0;
+	palette[1] = a1;
+	if (a0 > a1)
+	{
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+			palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+static int encodeAlphaEndpoints(const ColorBlock& block, int a0, int a1, unsigned char* out)
+{
+	int palette[8];
+	alphaPalette(a0, a1, palette);
+	unsigned long long bits = 0;
+	int error = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int value = (int)block.a[i];
+		int best = INT_MAX, bestIndex = 0;
+		for (int p = 0; p < 8; p++)
+		{
+			int d = (value - palette[p]) * (value - palette[p]);
+			if (d < best)
+			{
+				best = d;
+				bestIndex = p;
+			}
+		}
+		error += best;
+		bits |= (unsigned long long)bestIndex << (i * 3);
+	}
+	out[0] = (unsigned char)a0;
+	out[1] = (unsigned char)a1;
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = (unsigned char)(bits >> (i * 8));
+	return error;
+}
+
+static void encodeAlpha(const ColorBlock& block, CompressionQuality quality, unsigned char* out)
+{
+	int lo = 255, hi = 0, innerLo = 255, innerHi = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int a = (int)block.a[i];
+		lo = a < lo ? a : lo;
+		hi = a > hi ? a : hi;
+		if (a != 0 && a != 255)
+		{
+			innerLo = a < innerLo ? a : innerLo;
+			innerHi = a > innerHi ? a : innerHi;
+		}
+	}
+
+	// eight value mode spans min..max
+	int error = encodeAlphaEndpoints(block, hi, lo, out);
+	if (quality != CompressionQuality::High || innerLo > innerHi)
+		return;
+
+	// six value mode has exact 0 and 255, so it can spend its range on the values in between
+	unsigned char candidate[8];
+	int candidateError = encodeAlphaEndpoints(block, innerLo, innerHi, candidate);
+	if (candidateError < error)
+		memcpy(out, candidate, 8);
+}
+
+static void decodeAlpha(const unsigned char* in, unsigned char pixels[16][4])
+{
+	int palette[8];
+	alphaPalette(in[0], in[1], palette);
+	unsigned long long bits = 0;
+	for (int i = 0; i < 6; i++)
+		bits |= (unsigned long long)in[2 + i] << (i * 8);
+	for (int i = 0; i < 16; i++)
+		pixels[i][3] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+}
+
+// ---------------------------------------------------------------------------------------------
+// BC7 mode 6
+
+struct BitWriter
+{
+	unsigned char* out;
+	int position;
+
+	void write(unsigned int value, int bits)
+	{
+		for (int i = 0; i < bits; i++, position++)
+			if ((value >> i) & 1)
+				out[position >> 3] |= (unsigned char)(1 << (position & 7));
+	}
+};
+
+struct BitReader
+{
+	const unsigned char* in;
+	int position;
+
+	unsigned int read(int bits)
+	{
+		unsigned int value = 0;
+		for (int i = 0; i < bits; i++, position++)
+			value |= (unsigned int)((in[position >> 3] >> (position & 7)) & 1) << i;
+		return value;
+	}
+};
+
+// 7-bit endpoint plus shared p-bit, the p-bit becomes the lowest bit of each 8-bit channel
+static void quantizeBc7(const float e[4], int pbit, int q[4])
+{
+	for (int c = 0; c < 4; c++)
+		q[c] = clampi((int)floorf((e[c] - pbit) * 0.5f + 0.5f), 0, 127);
+}
+
+static float bc7QuantizationError(const float e[4], int pbit)
+{
+	int q[4];
+	quantizeBc7(e, pbit, q);
+	float error = 0.0f;
+	for (int c = 0; c < 4; c++)
+	{
+		float d = e[c] - (float)((q[c] << 1) | pbit);
+		error += d * d;
+	}
+	return error;
+}
+
+static float selectBc7Indices(const ColorBlock& block, const int q0[4], int p0, const int q1[4], int p1, unsigned char indices[16])
+{
+	float palette[16][4];
+	for (int c = 0; c < 4; c++)
+	{
+		int a = (q0[c] << 1) | p0, b = (q1[c] << 1) | p1;
+		for (int i = 0; i < 16; i++)
+			palette[i][c] = (float)(((64 - BC7_WEIGHTS[i]) * a + BC7_WEIGHTS[i] * b + 32) >> 6);
+	}
+
+	float error = 0.0f;
+	for (int i = 0; i < 16; i++)
+	{
+		float best = FLT_MAX;
+#ifdef BC_SSE2
+		__m128 pixel = _mm_setr_ps(block.r[i], block.g[i], block.b[i], block.a[i]);
+		for (int p = 0; p < 16; p++)
+		{
+			__m128 d = _mm_sub_ps(pixel, _mm_loadu_ps(palette[p]));
+			d = _mm_mul_ps(d, d);
+			d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+			d = _mm_add_ss(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+			float distance = _mm_cvtss_f32(d);
+#else
+		for (int p = 0; p < 16; p++)
+		{
+			float dr = block.r[i] - palette[p][0], dg = block.g[i] - palette[p][1];
+			float db = block.b[i] - palette[p][2], da = block.a[i] - palette[p][3];
+			float distance = dr * dr + dg * dg + db * db + da * da;
+#endif
+			if (distance < best)
+			{
+				best = distance;
+				indices[i] = (unsigned char)p;
+			}
+		}
+		error += best;
+	}
+	return error;
+}
+
+struct Bc7Candidate
+{
+	int q0[4], q1[4];
+	int p0, p1;
+	unsigned char indices[16];
+	float error;
+};
+
+static void evaluateBc7(const ColorBlock& block, const float e0[4], const float e1[4], bool allPbits, Bc7Candidate& best)
+{
+	for (int p0 = 0; p0 < 2; p0++)
+	{
+		for (int p1 = 0; p1 < 2; p1++)
+		{
+			if (!allPbits)
+			{
+				// pick each p-bit by how well it quantizes its own endpoint
+				p0 = bc7QuantizationError(e0, 1) < bc7QuantizationError(e0, 0) ? 1 : 0;
+				p1 = bc7QuantizationError(e1, 1) < bc7QuantizationError(e1, 0) ? 1 : 0;
+			}
+			Bc7Candidate candidate;
+			candidate.p0 = p0;
+			candidate.p1 = p1;
+			quantizeBc7(e0, p0, candidate.q0);
+			quantizeBc7(e1, p1, candidate.q1);
+			candidate.error = selectBc7Indices(block, candidate.q0, p0, candidate.q1, p1, candidate.indices);
+			if (candidate.error < best.error)
+				best = candidate;
+			if (!allPbits)
+				return;
+		}
+	}
+}
+
+static void encodeBc7(const ColorBlock& block, CompressionQuality quality, unsigned char* out)
+{
+	float lo[4], hi[4];
+	if (quality == CompressionQuality::Fast)
+		boundingBoxEndpoints(block, 4, lo, hi);
+	else
+		axisEndpoints(block, 4, lo, hi);
+
+	Bc7Candidate best;
+	best.error = FLT_MAX;
+	bool allPbits = quality == CompressionQuality::High;
+	evaluateBc7(block, lo, hi, allPbits, best);
+
+	if (quality == CompressionQuality::High)
+	{
+		for (int iteration = 0; iteration < 2; iteration++)
+		{
+			float weights[16], e0[4], e1[4];
+			for (int i = 0; i < 16; i++)
+				weights[i] = 1.0f - BC7_WEIGHTS[best.indices[i]] / 64.0f;
+			if (!refineEndpoints(block, 4, weights, NULL, e0, e1))
+				break;
+			float previous = best.error;
+			evaluateBc7(block, e0, e1, allPbits, best);
+			if (best.error >= previous)
+				break;
+		}
+	}
+
+	// the anchor (first) index is stored with its top bit implied zero
+	if (best.indices[0] & 8)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int t = best.q0[c];
+			best.q0[c] = best.q1[c];
+			best.q1[c] = t;
+		}
+		int t = best.p0;
+		best.p0 = best.p1;
+		best.p1 = t;
+		for (int i = 0; i < 16; i++)
+			best.indices[i] = (unsigned char)(15 - best.indices[i]);
+	}
+
+	memset(out, 0, 16);
+	BitWriter writer = { out, 0 };
+	writer.write(1 << 6, 7);  // mode 6
+	for (int c = 0; c < 4; c++)
+	{
+		writer.write(best.q0[c], 7);
+		writer.write(best.q1[c], 7);
+	}
+	writer.write(best.p0, 1);
+	writer.write(best.p1, 1);
+	writer.write(best.indices[0], 3);
+	for (int i = 1; i < 16; i++)
+		writer.write(best.indices[i], 4);
+}
+
+// only mode 6 is decoded, which is all the encoder produces; other modes come out as transparent black
+static void decodeBc7(const unsigned char* in, unsigned char pixels[16][4])
+{
+	BitReader reader = { in, 0 };
+	if (reader.read(7) != (1 << 6))
+	{
+		memset(pixels, 0, 16 * 4);
+		return;
+	}
+	int q[2][4];
+	for (int c = 0; c < 4; c++)
+	{
+		q[0][c] = reader.read(7);
+		q[1][c] = reader.read(7);
+	}
+	int p0 = reader.read(1), p1 = reader.read(1);
+	for (int i = 0; i < 16; i++)
+	{
+		int index = reader.read(i == 0 ? 3 : 4);
+		for (int c = 0; c < 4; c++)
+		{
+			int a = (q[0][c] << 1) | p0, b = (q[1][c] << 1) | p1;
+			pixels[i][c] = (unsigned char)(((64 - BC7_WEIGHTS[index]) * a + BC7_WEIGHTS[index] * b + 32) >> 6);
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------
+// ETC2 color (individual and differential modes) and EAC alpha
+
+static inline int etcModifier(int table, int index)
+{
+	int m = ETC_MODIFIERS[table][index & 1];
+	return index & 2 ? -m : m;
+}
+
+// best modifier table and pixel indices for the eight pixels of one subblock around base
+static int fitEtcSubblock(const ColorBlock& block, const int pixels[8], const int base[3], int& table, unsigned char indices[16])
+{
+	int bestError = INT_MAX;
+	for (int t = 0; t < 8; t++)
+	{
+		int error = 0;
+		unsigned char chosen[8];
+		for (int k = 0; k < 8 && error < bestError; k++)
+		{
+			int i = pixels[k];
+			int best = INT_MAX;
+			for (int index = 0; index < 4; index++)
+			{
+				int m = etcModifier(t, index);
+				int dr = (int)block.r[i] - clampi(base[0] + m, 0, 255);
+				int dg = (int)block.g[i] - clampi(base[1] + m, 0, 255);
+				int db = (int)block.b[i] - clampi(base[2] + m, 0, 255);
+				int d = dr * dr + dg * dg + db * db;
+				if (d < best)
+				{
+					best = d;
+					chosen[k] = (unsigned char)index;
+				}
+			}
+			error += best;
+		}
+		if (error < bestError)
+		{
+			bestError = error;
+			table = t;
+			for (int k = 0; k < 8; k++)
+				indices[pixels[k]] = chosen[k];
+		}
+	}
+	return bestError;
+}
+
+struct EtcCandidate
+{
+	bool differential;
+	bool flip;
+	int base[2][3];  // quantized: 5 bits (differential) or 4 bits (individual)
+	int table[2];
+	unsigned char indices[16];
+	int error;
+};
+
+static void expandEtcBase(const int quantized[3], bool differential, int base[3])
+{
+	for (int c = 0; c < 3; c++)
+		base[c] = differential ? (quantized[c] << 3) | (quantized[c] >> 2) : (quantized[c] << 4) | quantized[c];
+}
+
+static void evaluateEtc(const ColorBlock& block, const int pixels[2][8], EtcCandidate& candidate, EtcCandidate& best)
+{
+	candidate.error = 0;
+	for (int s = 0; s < 2 && candidate.error < best.error; s++)
+	{
+		int base[3];
+		expandEtcBase(candidate.base[s], candidate.differential, base);
+		candidate.error += fitEtcSubblock(block, pixels[s], base, candidate.table[s], candidate.indices);
+	}
+	if (candidate.error < best.error)
+		best = candidate;
+}
+
+static void encodeEtcColor(const ColorBlock& block, CompressionQuality quality, unsigned char* out)
+{
+	EtcCandidate best;
+	best.error = INT_MAX;
+
+	for (int flip = 0; flip < 2; flip++)
+	{
+		// flip 0 splits the block into left/right 2x4 halves, flip 1 into top/bottom 4x2 halves
+		int pixels[2][8];
+		int counts[2] = { 0, 0 };
+		float average[2][3] = {};
+		for (int y = 0; y < 4; y++)
+		{
+			for (int x = 0; x < 4; x++)
+			{
+				int s = flip ? (y >= 2) : (x >= 2);
+				int i = y * 4 + x;
+				pixels[s][counts[s]++] = i;
+				average[s][0] += block.r[i] / 8.0f;
+				average[s][1] += block.g[i] / 8.0f;
+				average[s][2] += block.b[i] / 8.0f;
+			}
+		}
+
+		EtcCandidate candidate;
+		candidate.flip = flip != 0;
+
+		// differential mode: 5-bit base plus a 3-bit signed delta for the second subblock
+		candidate.differential = true;
+		for (int c = 0; c < 3; c++)
+		{
+			int b0 = clampi((int)(average[0][c] * 31.0f / 255.0f + 0.5f), 0, 31);
+			int b1 = clampi((int)(average[1][c] * 31.0f / 255.0f + 0.5f), 0, 31);
+			candidate.base[0][c] = b0;
+			candidate.base[1][c] = b0 + clampi(b1 - b0, -4, 3);
+		}
+		evaluateEtc(block, pixels, candidate, best);
+
+		if (quality == CompressionQuality::High)
+		{
+			// nudge each base brightness by one step, the modifier tables are asymmetric around it
+			EtcCandidate nudged = candidate;
+			for (int s = 0; s < 2; s++)
+			{
+				for (int offset = -1; offset <= 1; offset += 2)
+				{
+					nudged = candidate;
+					bool valid = true;
+					for (int c = 0; c < 3; c++)
+					{
+						nudged.base[s][c] = candidate.base[s][c] + offset;
+						int delta = nudged.base[1][c] - nudged.base[0][c];
+						valid = valid && nudged.base[s][c] >= 0 && nudged.base[s][c] <= 31 && delta >= -4 && delta <= 3;
+					}
+					if (valid)
+						evaluateEtc(block, pixels, nudged, best);
+				}
+			}
+		}
+
+		// individual mode: two independent 4-bit bases, better when the halves differ a lot
+		if (quality != CompressionQuality::Fast)
+		{
+			candidate.differential = false;
+			for (int s = 0; s < 2; s++)
+				for (int c = 0; c < 3; c++)
+					candidate.base[s][c] = clampi((int)(average[s][c] * 15.0f / 255.0f + 0.5f), 0, 15);
+			evaluateEtc(block, pixels, candidate, best);
+		}
+	}
+
+	unsigned int high = 0, low = 0;
+	if (best.differential)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			int delta = best.base[1][c] - best.base[0][c];
+			high |= (unsigned int)best.base[0][c] << (27 - c * 8);
+			high |= (unsigned int)(delta & 7) << (24 - c * 8);
+		}
+	}
+	else
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			high |= (unsigned int)best.base[0][c] << (28 - c * 8);
+			high |= (unsigned int)best.base[1][c] << (24 - c * 8);
+		}
+	}
+	high |= (unsigned int)best.table[0] << 5;
+	high |= (unsigned int)best.table[1] << 2;
+	high |= (unsigned int)best.differential << 1;
+	high |= (unsigned int)best.flip;
+
+	// pixel indices are stored column-major, most significant bits in the upper half
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+		{
+			int index = best.indices[y * 4 + x];
+			int k = x * 4 + y;
+			low |= (unsigned int)((index >> 1) & 1) << (16 + k);
+			low |= (unsigned int)(index & 1) << k;
+		}
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		out[i] = (unsigned char)(high >> (24 - i * 8));
+		out[4 + i] = (unsigned char)(low >> (24 - i * 8));
+	}
+}
+
+// decodes the individual and differential modes the encoder emits (not T, H or planar)
+static void decodeEtcColor(const unsigned char* in, unsigned char pixels[16][4])
+{
+	unsigned int high = ((unsigned int)in[0] << 24) | (in[1] << 16) | (in[2] << 8) | in[3];
+	unsigned int low = ((unsigned int)in[4] << 24) | (in[5] << 16) | (in[6] << 8) | in[7];
+	bool differential = (high >> 1) & 1;
+	bool flip = high & 1;
+	int table[2] = { (int)(high >> 5) & 7, (int)(high >> 2) & 7 };
+	int quantized[2][3], base[2][3];
+	for (int c = 0; c < 3; c++)
+	{
+		if (differential)
+		{
+			quantized[0][c] = (high >> (27 - c * 8)) & 31;
+			int delta = (high >> (24 - c * 8)) & 7;
+			quantized[1][c] = quantized[0][c] + (delta >= 4 ? delta - 8 : delta);
+		}
+		else
+		{
+			quantized[0][c] = (high >> (28 - c * 8)) & 15;
+			quantized[1][c] = (high >> (24 - c * 8)) & 15;
+		}
+	}
+	expandEtcBase(quantized[0], differential, base[0]);
+	expandEtcBase(quantized[1], differential, base[1]);
+
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+		{
+			int s = flip ? (y >= 2) : (x >= 2);
+			int k = x * 4 + y;
+			int index = (int)(((low >> (16 + k)) & 1) << 1 | ((low >> k) & 1));
+			int m = etcModifier(table[s], index);
+			unsigned char* p = pixels[y * 4 + x];
+			for (int c = 0; c < 3; c++)
+				p[c] = (unsigned char)clampi(base[s][c] + m, 0, 255);
+			p[3] = 255;
+		}
+	}
+}
+
+static int encodeEacCandidate(const ColorBlock& block, int base, int multiplier, int table, unsigned long long* bits)
+{
+	int error = 0;
+	unsigned long long packed = ((unsigned long long)base << 56) | ((unsigned long long)multiplier << 52) | ((unsigned long long)table << 48);
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+		{
+			int value = (int)block.a[y * 4 + x];
+			int best = INT_MAX, bestIndex = 0;
+			for (int index = 0; index < 8; index++)
+			{
+				int d = value - clampi(base + EAC_MODIFIERS[table][index] * multiplier, 0, 255);
+				if (d * d < best)
+				{
+					best = d * d;
+					bestIndex = index;
+				}
+			}
+			error += best;
+			packed |= (unsigned long long)bestIndex << (45 - 3 * (x * 4 + y));
+		}
+	}
+	*bits = packed;
+	return error;
+}
+
+static void encodeEacAlpha(const ColorBlock& block, CompressionQuality quality, unsigned char* out)
+{
+	int lo = 255, hi = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		lo = (int)block.a[i] < lo ? (int)block.a[i] : lo;
+		hi = (int)block.a[i] > hi ? (int)block.a[i] : hi;
+	}
+
+	int bestError = INT_MAX;
+	unsigned long long bestBits = 0;
+	int center = (lo + hi + 1) / 2;
+	int baseRadius = quality == CompressionQuality::High ? 1 : 0;
+	for (int base = center - baseRadius; base <= center + baseRadius; base++)
+	{
+		if (base < 0 || base > 255)
+			continue;
+		for (int table = 0; table < 16; table++)
+		{
+			// multiplier that stretches this table's range over the block's range
+			int span = EAC_MODIFIERS[table][7] - EAC_MODIFIERS[table][3];
+			int guess = clampi((hi - lo + span / 2) / span, 1, 15);
+			int first = guess, last = guess;
+			if (quality == CompressionQuality::Normal)
+			{
+				first = guess - 1;
+				last = guess + 1;
+			}
+			else if (quality == CompressionQuality::High)
+			{
+				first = guess - 3;
+				last = guess + 3;
+			}
+			for (int multiplier = clampi(first, 1, 15); multiplier <= clampi(last, 1, 15); multiplier++)
+			{
+				unsigned long long bits;
+				int error = encodeEacCandidate(block, base, multiplier, table, &bits);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestBits = bits;
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < 8; i++)
+		out[i] = (unsigned char)(bestBits >> (56 - i * 8));
+}
+
+static void decodeEacAlpha(const unsigned char* in, unsigned char pixels[16][4])
+{
+	unsigned long long bits = 0;
+	for (int i = 0; i < 8; i++)
+		bits = (bits << 8) | in[i];
+	int base = (int)(bits >> 56) & 0xFF;
+	int multiplier = (int)(bits >> 52) & 0xF;
+	int table = (int)(bits >> 48) & 0xF;
+	for (int y = 0; y < 4; y++)
+	{
+		for (int x = 0; x < 4; x++)
+		{
+			int index = (int)(bits >> (45 - 3 * (x * 4 + y))) & 7;
+			pixels[y * 4 + x][3] = (unsigned char)clampi(base + EAC_MODIFIERS[table][index] * multiplier, 0, 255);
+		}
+	}
+}
+
+// ---------------------------------------------------------------------------------------------
+
+static void encodeBlock(const ColorBlock& block, BlockFormat format, CompressionQuality quality, unsigned char* out)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		encodeColor(block, true, quality, out);
+		break;
+	case BlockFormat::BC3:
+		encodeAlpha(block, quality, out);
+		encodeColor(block, false, quality, out + 8);
+		break;
+	case BlockFormat::BC7:
+		encodeBc7(block, quality, out);
+		break;
+	case BlockFormat::ETC2_RGB:
+		encodeEtcColor(block, quality, out);
+		break;
+	case BlockFormat::ETC2_RGBA:
+		encodeEacAlpha(block, quality, out);
+		encodeEtcColor(block, quality, out + 8);
+		break;
+	default:
+		break;
+	}
+}
+
+static void decodeBlock(const unsigned char* in, BlockFormat format, unsigned char pixels[16][4])
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		decodeColor(in, true, pixels);
+		break;
+	case BlockFormat::BC3:
+		decodeColor(in + 8, false, pixels);
+		decodeAlpha(in, pixels);
+		break;
+	case BlockFormat::BC7:
+		decodeBc7(in, pixels);
+		break;
+	case BlockFormat::ETC2_RGB:
+		decodeEtcColor(in, pixels);
+		break;
+	case BlockFormat::ETC2_RGBA:
+		decodeEtcColor(in + 8, pixels);
+		decodeEacAlpha(in, pixels);
+		break;
+	default:
+		memset(pixels, 0, 16 * 4);
+		break;
+	}
+}
+
+void BlockCompressor::compress(const unsigned char* rgba, int width, int height, BlockFormat format,
+	CompressionQuality quality, unsigned char* dst, JobSystem* jobs)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t bytes = blockBytes(format);
+
+	auto encodeRows = [=](int firstRow, int lastRow)
+	{
+		ColorBlock block;
+		for (int by = firstRow; by < lastRow; by++)
+		{
+			for (int bx = 0; bx < blocksX; bx++)
+			{
+				loadBlock(rgba, width, height, bx, by, block);
+				encodeBlock(block, format, quality, dst + ((size_t)by * blocksX + bx) * bytes);
+			}
+		}
+	};
+
+	if (!jobs)
+	{
+		encodeRows(0, blocksY);
+		return;
+	}
+	// contiguous bands of block rows
+	jobs->parallelFor((size_t)blocksY, ROWS_PER_JOB, [&](size_t first, size_t last) { encodeRows((int)first, (int)last); });
+}
+
+void BlockCompressor::decompress(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* rgba)
+{
+	int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t bytes = blockBytes(format);
+	unsigned char pixels[16][4];
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			decodeBlock(blocks + ((size_t)by * blocksX + bx) * bytes, format, pixels);
+			for (int y = 0; y < 4 && by * 4 + y < height; y++)
+				for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+					memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, pixels[y * 4 + x], 4);
+		}
+	}
+}
+
+double BlockCompressor::psnr(const unsigned char* rgba, int width, int height, BlockFormat format, const unsigned char* blocks)
+{
+	std::vector<unsigned char> decoded((size_t)width * height * 4);
+	decompress(blocks, width, height, format, decoded.data());
+
+	// BC1 and ETC2 RGB only carry color (BC1 alpha is a 1-bit cutout), so alpha is left out of their error
+	int channels = format == BlockFormat::BC1 || format == BlockFormat::ETC2_RGB ? 3 : 4;
+	double sum = 0.0;
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		for (int c = 0; c < channels; c++)
+		{
+			double d = (double)rgba[i * 4 + c] - decoded[i * 4 + c];
+			sum += d * d;
+		}
+	}
+	double mse = sum / ((double)width * height * channels);
+	if (mse == 0.0)
+		return std::numeric_limits<double>::infinity();
+	return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+size_t BlockCompressor::blockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 || format == BlockFormat::ETC2_RGB ? 8 : 16;
+}
+
+size_t BlockCompressor::compressedSize(int width, int height, BlockFormat format)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+GLenum BlockCompressor::glFormat(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case BlockFormat::BC3:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC7:
+		return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	case BlockFormat::ETC2_RGB:
+		return srgb ? GL_COMPRESSED_SRGB8_ETC2 : GL_COMPRESSED_RGB8_ETC2;
+	case BlockFormat::ETC2_RGBA:
+		return srgb ? GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC : GL_COMPRESSED_RGBA8_ETC2_EAC;
+	default:
+		return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	}
+}
+
+bool BlockCompressor::isSupported(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	case BlockFormat::BC3:
+		// the sRGB S3TC formats come from a separate extension
+		if (!Texture::hasExtension("GL_EXT_texture_compression_s3tc"))
+			return false;
+		return !srgb || Texture::hasExtension("GL_EXT_texture_sRGB")
+			|| Texture::hasExtension("GL_EXT_texture_compression_s3tc_srgb");
+	default:
+		// BPTC is core since 4.2 and ETC2 since 4.3 (desktop drivers may decompress ETC2 on upload)
+		return true;
+	}
+}
+
+const char* BlockCompressor::name(BlockFormat format)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return "BC1";
+	case BlockFormat::BC3: return "BC3";
+	case BlockFormat::BC7: return "BC7";
+	case BlockFormat::ETC2_RGB: return "ETC2 RGB";
+	case BlockFormat::ETC2_RGBA: return "ETC2 RGBA";
+	default: return "uncompressed";
+	}
+}
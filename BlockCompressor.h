@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+#include "JobSystem.h"
+
+// S3TC is an extension rather than core GL, so its enums may be missing from the loader
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// GPU block compression formats the encoder can produce
+enum class BlockFormat
+{
+	None,
+	BC1,       // RGB + 1-bit alpha, 8 bytes per 4x4 block (DXT1)
+	BC3,       // RGBA, 16 bytes per block (DXT5)
+	BC7,       // RGBA, 16 bytes per block, mode 6 only (one subset, 7.7.7.7 endpoints, 4-bit indices)
+	ETC2_RGB,  // GLES targets, 8 bytes per block, ETC1-compatible individual/differential modes
+	ETC2_RGBA  // ETC2 color + EAC alpha, 16 bytes per block
+};
+
+// encoder effort: endpoint search and how many candidate encodings are tried per block
+enum class CompressionQuality
+{
+	Fast,    // bounding box endpoints, single pass
+	Normal,  // principal axis endpoints
+	High     // principal axis plus least squares refinement and wider mode search
+};
+
+// Encodes RGBA8 images into 4x4 block compressed formats for glCompressedTexSubImage2D.
+// Images of any size are handled; partial edge blocks repeat the border texels.
+class BlockCompressor
+{
+public:
+	// compress width*height RGBA8 pixels into dst (compressedSize bytes); with jobs, bands of block
+	// rows are encoded in parallel on the JobSystem, without it on the calling thread
+	static void compress(const unsigned char* rgba, int width, int height, BlockFormat format,
+		CompressionQuality quality, unsigned char* dst, JobSystem* jobs = NULL);
+	// decode blocks back to RGBA8 (width*height*4 bytes)
+	static void decompress(const unsigned char* blocks, int width, int height, BlockFormat format, unsigned char* rgba);
+	// peak signal to noise ratio in dB of the compressed image against the source, over the channels the format stores
+	static double psnr(const unsigned char* rgba, int width, int height, BlockFormat format, const unsigned char* blocks);
+
+	static size_t blockBytes(BlockFormat format);
+	static size_t compressedSize(int width, int height, BlockFormat format);
+	static GLenum glFormat(BlockFormat format, bool srgb);
+	// whether the current GL context can sample the format, in its sRGB variant if srgb is set
+	static bool isSupported(BlockFormat format, bool srgb = false);
+	static const char* name(BlockFormat format);
+};
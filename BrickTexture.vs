@@ -5,11 +5,49 @@ layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
 out vec3 ourColor;
 out vec2 TexCoord;
+// table indices and blend of the two textures, for the TextureTable fragment shaders
+flat out int TextureIndex1;
+flat out int TextureIndex2;
+out float MixFactor;
+
 uniform mat4 transform;
+uniform int textureIndex1;
+uniform int textureIndex2;
+uniform float mixFactor;
+
+// per-object data of InstancedQuads (one record per instance) or of a RenderQueue
+// (one record per draw of a multi-draw, indirect set), used instead of the uniforms above when instanced is set
+struct Instance
+{
+	mat4 transform;
+	ivec2 textures;
+	float mixFactor;
+	float padding;
+};
+layout (std430, binding = 1) readonly buffer Instances
+{
+	Instance instances[];
+};
+uniform bool instanced;
+uniform bool indirect;
 
 void main()
 {
-	gl_Position = transform * vec4(aPos, 1.0f);
+	if (instanced)
+	{
+		Instance instance = instances[indirect ? gl_DrawID : gl_BaseInstance + gl_InstanceID];
+		gl_Position = instance.transform * vec4(aPos, 1.0f);
+		TextureIndex1 = instance.textures.x;
+		TextureIndex2 = instance.textures.y;
+		MixFactor = instance.mixFactor;
+	}
+	else
+	{
+		gl_Position = transform * vec4(aPos, 1.0f);
+		TextureIndex1 = textureIndex1;
+		TextureIndex2 = textureIndex2;
+		MixFactor = mixFactor;
+	}
 	ourColor = aColor;
 	TexCoord = vec2(aTexCoord.x, aTexCoord.y);
-}
\ No newline at end of file
+}
@@ -0,0 +1,16 @@
+#version 460 core
+
+out vec4 FragColor;
+in vec3 ourColor;
+in vec2 TexCoord;
+uniform sampler2DArray textures;
+// layers picked from the TextureTable
+flat in int TextureIndex1;
+flat in int TextureIndex2;
+in float MixFactor;
+
+void main()
+{
+    FragColor = mix(texture(textures, vec3(TexCoord, TextureIndex1)),
+                    texture(textures, vec3(TexCoord, TextureIndex2)), MixFactor);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+// instances of one draw may pick different handles, which the ARB extension only
+// allows for dynamically uniform values; gpu_shader5 lifts that where it exists
+#extension GL_NV_gpu_shader5 : enable
+
+out vec4 FragColor;
+in vec3 ourColor;
+in vec2 TexCoord;
+// resident handles written by the TextureTable
+layout (std430, binding = 0) readonly buffer TextureHandles
+{
+    uvec2 handles[];
+};
+flat in int TextureIndex1;
+flat in int TextureIndex2;
+in float MixFactor;
+
+void main()
+{
+    FragColor = mix(texture(sampler2D(handles[TextureIndex1]), TexCoord),
+                    texture(sampler2D(handles[TextureIndex2]), TexCoord), MixFactor);
+}
\ No newline at end of file
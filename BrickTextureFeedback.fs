@@ -0,0 +1,35 @@
+#version 460 core
+
+// feedback pass of BrickTextureVirtual.fs: writes the page and level each
+// pixel would sample, read back by VirtualTexture to decide what to load
+layout (location = 0) out vec4 Feedback;
+in vec2 TexCoord;
+
+uniform vec2 virtualSize;
+uniform int levelCount;
+uniform float feedbackBias;  // the pass runs at reduced resolution, so derivatives are that much larger
+
+const float PAGE_CONTENT = 120.0;
+
+vec2 levelSize(int level)
+{
+    return max(floor(virtualSize / exp2(float(level))), vec2(1.0));
+}
+
+ivec2 pageOf(vec2 uv, int level)
+{
+    vec2 size = levelSize(level);
+    ivec2 pages = ivec2(ceil(size / PAGE_CONTENT));
+    return clamp(ivec2(uv * size / PAGE_CONTENT), ivec2(0), pages - 1);
+}
+
+void main()
+{
+    vec2 uv = clamp(TexCoord, 0.0, 1.0);
+    vec2 texel = uv * virtualSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + feedbackBias;
+    int level = int(clamp(lod, 0.0, float(levelCount - 1)));
+    ivec2 page = pageOf(uv, level);
+    Feedback = vec4(page.x, page.y, level, 255.0) / 255.0;
+}
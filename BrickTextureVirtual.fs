@@ -0,0 +1,64 @@
+#version 460 core
+
+out vec4 FragColor;
+in vec3 ourColor;
+in vec2 TexCoord;
+uniform sampler2D texture2;
+
+// texture1 of BrickTexture.fs as a VirtualTexture: the page table maps each
+// page of each level to a tile of the physical cache
+uniform usampler2D pageTable;
+uniform sampler2D physicalCache;
+uniform vec2 virtualSize;      // level 0 size in texels
+uniform int levelCount;
+uniform int tableOffsets[16];  // x of each level's pages in the page table
+uniform float cacheSize;       // physical cache size in texels
+
+const float PAGE_SIZE = 128.0;
+const float PAGE_BORDER = 4.0;
+const float PAGE_CONTENT = 120.0;
+
+vec2 levelSize(int level)
+{
+    return max(floor(virtualSize / exp2(float(level))), vec2(1.0));
+}
+
+ivec2 pageOf(vec2 uv, int level)
+{
+    vec2 size = levelSize(level);
+    ivec2 pages = ivec2(ceil(size / PAGE_CONTENT));
+    return clamp(ivec2(uv * size / PAGE_CONTENT), ivec2(0), pages - 1);
+}
+
+int virtualLevel(vec2 uv)
+{
+    vec2 texel = uv * virtualSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    return int(clamp(lod, 0.0, float(levelCount - 1)));
+}
+
+vec4 sampleVirtual(vec2 uv)
+{
+    uv = clamp(uv, 0.0, 1.0);
+    int level = virtualLevel(uv);
+    // a missing page names a coarser level; follow it until an entry holds its own level
+    uvec4 entry = uvec4(0);
+    for (int i = 0; i < levelCount; i++)
+    {
+        ivec2 page = pageOf(uv, level);
+        entry = texelFetch(pageTable, ivec2(tableOffsets[level] + page.x, page.y), 0);
+        if (int(entry.b) == level)
+            break;
+        level = int(entry.b);
+    }
+    vec2 inPage = uv * levelSize(level) - vec2(pageOf(uv, level)) * PAGE_CONTENT;
+    vec2 texel = vec2(entry.rg) * PAGE_SIZE + PAGE_BORDER + inPage;
+    return textureLod(physicalCache, texel / cacheSize, 0.0);
+}
+
+void main()
+{
+    FragColor = mix(sampleVirtual(TexCoord),
+                    texture(texture2, TexCoord), 0.8);
+}
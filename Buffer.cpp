@@ -0,0 +1,30 @@
+#include "Buffer.h"
+
+Buffer::Buffer(size_t size, const void* data, GLbitfield flags)
+	: ID(0), size(size)
+{
+	glCreateBuffers(1, &ID);
+	glNamedBufferStorage(ID, size, data, flags);
+}
+
+void Buffer::update(size_t offset, size_t length, const void* data) const
+{
+	glNamedBufferSubData(ID, offset, length, data);
+}
+
+void* Buffer::map(size_t offset, size_t length, GLbitfield access) const
+{
+	return glMapNamedBufferRange(ID, offset, length, access);
+}
+
+void Buffer::unmap() const
+{
+	glUnmapNamedBuffer(ID);
+}
+
+void Buffer::dispose()
+{
+	glDeleteBuffers(1, &ID);
+	ID = 0;
+	size = 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// Buffer object with immutable storage, created and edited through direct
+// state access (glCreateBuffers, glNamedBufferStorage, glNamedBufferSubData):
+// no bind point is touched, so creating or refilling a buffer never disturbs
+// what the current draw has bound. Bind the ID only where GL reads it.
+class Buffer
+{
+public:
+	// the buffer ID
+	unsigned int ID;
+	size_t size;
+
+	// flags are glBufferStorage flags: GL_DYNAMIC_STORAGE_BIT allows update(), GL_MAP_*_BIT allow map()
+	Buffer(size_t size, const void* data = NULL, GLbitfield flags = GL_DYNAMIC_STORAGE_BIT);
+	void update(size_t offset, size_t length, const void* data) const;
+	void* map(size_t offset, size_t length, GLbitfield access) const;
+	void unmap() const;
+	void dispose();
+};
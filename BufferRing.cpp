@@ -0,0 +1,72 @@
+#include "BufferRing.h"
+
+BufferRing::BufferRing(size_t frameSize, unsigned int frames)
+	: ID(0), mapped(NULL), regionSize(frameSize), frames(frames ? frames : 1), current(0), fences(this->frames, (GLsync)0),
+	head(0)
+{
+	// coherent: CPU writes become visible to the GPU without an explicit flush
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &ID);
+	glNamedBufferStorage(ID, regionSize * this->frames, NULL, flags);
+	mapped = (unsigned char*)glMapNamedBufferRange(ID, 0, regionSize * this->frames, flags);
+	if (!mapped)
+		std::cout << "ERROR::BUFFER_RING::MAP_FAILED" << std::endl;
+	// the first frame starts at region 0 without a beginFrame()
+	current = this->frames - 1;
+	beginFrame();
+}
+
+void BufferRing::beginFrame()
+{
+	current = (current + 1) % frames;
+	GLsync& fence = fences[current];
+	if (fence)
+	{
+		// blocks only if the GPU is a full ring of frames behind
+		GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		glDeleteSync(fence);
+		fence = 0;
+	}
+	head.store(0, std::memory_order_relaxed);
+}
+
+void* BufferRing::allocate(size_t size, size_t& offset, size_t alignment)
+{
+	if (!mapped)
+		return NULL;
+	size_t start = head.load(std::memory_order_relaxed);
+	size_t aligned;
+	do
+	{
+		aligned = (start + alignment - 1) / alignment * alignment;
+		if (aligned + size > regionSize)
+			return NULL;
+	} while (!head.compare_exchange_weak(start, aligned + size, std::memory_order_relaxed));
+
+	offset = current * regionSize + aligned;
+	return mapped + offset;
+}
+
+void BufferRing::endFrame()
+{
+	fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void BufferRing::dispose()
+{
+	for (size_t i = 0; i < fences.size(); i++)
+	{
+		if (fences[i])
+			glDeleteSync(fences[i]);
+		fences[i] = 0;
+	}
+	if (mapped)
+	{
+		glUnmapNamedBuffer(ID);
+		mapped = NULL;
+	}
+	glDeleteBuffers(1, &ID);
+	ID = 0;
+}
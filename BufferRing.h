@@ -0,0 +1,46 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Persistently mapped buffer for geometry that changes every frame (UI,
+// particles, debug lines). The storage (glBufferStorage, coherent mapping)
+// is split into one region per frame in flight. During a frame producers
+// reserve space in the current region with allocate(), from any thread, and
+// write vertices straight into the mapping: no glBufferSubData copy and no
+// orphaning. endFrame() fences the region once the frame's draws are issued
+// and beginFrame() only waits when the GPU is still reading the region it is
+// about to reuse, which with three regions means the GPU is frames behind.
+class BufferRing
+{
+public:
+	// the buffer name, bind it to any target (GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, ...)
+	unsigned int ID;
+
+	BufferRing(size_t frameSize = 4 * 1024 * 1024, unsigned int frames = 3);
+
+	// GL thread, before producers run: move to the next region, waiting for the GPU if it still reads it
+	void beginFrame();
+	// any thread: reserve size bytes of the current region; returns the mapped pointer and the byte
+	// offset into the buffer for draw calls, or NULL when the region is full
+	void* allocate(size_t size, size_t& offset, size_t alignment = 16);
+	// GL thread, after the last draw reading this frame's region
+	void endFrame();
+
+	size_t frameSize() const { return regionSize; }
+	// bytes allocated in the current frame
+	size_t used() const { return head.load(std::memory_order_relaxed); }
+	void dispose();
+
+private:
+	unsigned char* mapped;
+	size_t regionSize;
+	unsigned int frames;
+	unsigned int current;
+	std::vector<GLsync> fences;
+	std::atomic<size_t> head;
+};
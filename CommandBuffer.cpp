@@ -0,0 +1,174 @@
+#include "CommandBuffer.h"
+
+static const int LAYER_BITS = 8, SHADER_BITS = 12, TEXTURE_BITS = 14, VAO_BITS = 12, DEPTH_BITS = 18;
+
+void CommandList::draw(Shader& shader, unsigned int vao, unsigned int texture, const QuadInstance& data,
+	unsigned int layer, float depth, GLuint count, GLuint firstIndex, GLint baseVertex)
+{
+	DrawCommand command = { CommandBuffer::makeKey(layer, shader.ID, texture, vao, depth), &shader, vao, texture, count,
+		firstIndex, baseVertex, (uint32_t)instances.size() };
+	commands.push_back(command);
+	instances.push_back(data);
+}
+
+void CommandList::clear()
+{
+	commands.clear();
+	instances.clear();
+}
+
+CommandBuffer::CommandBuffer(unsigned int threads, size_t capacity)
+	: lists(threads ? threads : 1), commandBuffer(0), dataBuffer(0), commandCapacity(0), dataCapacity(0)
+{
+	glCreateBuffers(1, &commandBuffer);
+	glCreateBuffers(1, &dataBuffer);
+	reserve(commandBuffer, commandCapacity, capacity * sizeof(DrawElementsIndirectCommand));
+	reserve(dataBuffer, dataCapacity, capacity * sizeof(QuadInstance));
+}
+
+uint64_t CommandBuffer::makeKey(unsigned int layer, unsigned int shader, unsigned int texture, unsigned int vao,
+	float depth)
+{
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+	else if (depth > 1.0f)
+		depth = 1.0f;
+	uint64_t quantized = (uint64_t)(depth * (float)((1 << DEPTH_BITS) - 1) + 0.5f);
+
+	uint64_t key = layer & ((1u << LAYER_BITS) - 1);
+	key = (key << SHADER_BITS) | (shader & ((1u << SHADER_BITS) - 1));
+	key = (key << TEXTURE_BITS) | (texture & ((1u << TEXTURE_BITS) - 1));
+	key = (key << VAO_BITS) | (vao & ((1u << VAO_BITS) - 1));
+	key = (key << DEPTH_BITS) | quantized;
+	return key;
+}
+
+int CommandBuffer::submit()
+{
+	entries.clear();
+	for (size_t l = 0; l < lists.size(); l++)
+	{
+		const std::vector<DrawCommand>& commands = lists[l].commands;
+		for (size_t i = 0; i < commands.size(); i++)
+		{
+			SortEntry entry = { commands[i].key, (uint32_t)l, (uint32_t)i };
+			entries.push_back(entry);
+		}
+	}
+	if (entries.empty())
+		return 0;
+	radixSort(entries, scratch);
+
+	// records and commands in sorted order: baseInstance is the record's position in the upload
+	indirect.resize(entries.size());
+	instances.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const CommandList& list = lists[entries[i].list];
+		const DrawCommand& command = list.commands[entries[i].index];
+		DrawElementsIndirectCommand draw = { command.count, 1, command.firstIndex, command.baseVertex, (GLuint)i };
+		indirect[i] = draw;
+		instances[i] = list.instances[command.instance];
+	}
+	reserve(dataBuffer, dataCapacity, instances.size() * sizeof(QuadInstance));
+	glNamedBufferSubData(dataBuffer, 0, instances.size() * sizeof(QuadInstance), instances.data());
+	reserve(commandBuffer, commandCapacity, indirect.size() * sizeof(DrawElementsIndirectCommand));
+	glNamedBufferSubData(commandBuffer, 0, indirect.size() * sizeof(DrawElementsIndirectCommand), indirect.data());
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstancedQuads::INSTANCE_BINDING, dataBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	int multiDraws = 0;
+	Shader* current = NULL;
+	for (size_t start = 0; start < entries.size();)
+	{
+		const DrawCommand& first = lists[entries[start].list].commands[entries[start].index];
+		size_t end = start + 1;
+		while (end < entries.size())
+		{
+			const DrawCommand& next = lists[entries[end].list].commands[entries[end].index];
+			if (next.shader != first.shader || next.texture != first.texture || next.vao != first.vao)
+				break;
+			end++;
+		}
+
+		if (first.shader != current)
+		{
+			if (current)
+				current->setBool("instanced", false);
+			first.shader->use();
+			first.shader->setBool("instanced", true);
+			current = first.shader;
+		}
+		if (first.texture)
+			GLState::bindTexture(0, first.texture);
+		GLState::bindVertexArray(first.vao);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(start * sizeof(DrawElementsIndirectCommand)),
+			(GLsizei)(end - start), 0);
+		multiDraws++;
+		start = end;
+	}
+	current->setBool("instanced", false);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	for (size_t l = 0; l < lists.size(); l++)
+		lists[l].clear();
+	return multiDraws;
+}
+
+void CommandBuffer::dispose()
+{
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteBuffers(1, &dataBuffer);
+	commandBuffer = dataBuffer = 0;
+	for (size_t l = 0; l < lists.size(); l++)
+		lists[l].clear();
+}
+
+void CommandBuffer::radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	// all eight histograms in one read of the keys
+	size_t counts[8][256] = {};
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		uint64_t key = entries[i].key;
+		for (int pass = 0; pass < 8; pass++)
+			counts[pass][(key >> (pass * 8)) & 0xFF]++;
+	}
+
+	scratch.resize(entries.size());
+	std::vector<SortEntry>* from = &entries;
+	std::vector<SortEntry>* to = &scratch;
+	for (int pass = 0; pass < 8; pass++)
+	{
+		size_t* count = counts[pass];
+		// one bucket holds everything: this byte is the same in every key (unused layers, one shader, ...)
+		if (count[((*from)[0].key >> (pass * 8)) & 0xFF] == entries.size())
+			continue;
+
+		size_t offsets[256];
+		size_t sum = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			offsets[b] = sum;
+			sum += count[b];
+		}
+		for (size_t i = 0; i < from->size(); i++)
+		{
+			const SortEntry& entry = (*from)[i];
+			(*to)[offsets[(entry.key >> (pass * 8)) & 0xFF]++] = entry;
+		}
+		std::swap(from, to);
+	}
+	if (from != &entries)
+		entries.swap(scratch);
+}
+
+void CommandBuffer::reserve(unsigned int buffer, size_t& capacity, size_t size)
+{
+	size_t wanted = capacity ? capacity : 1;
+	while (wanted < size)
+		wanted *= 2;
+	// orphan every frame so uploads never wait for the GPU to finish last frame's draws
+	glNamedBufferData(buffer, wanted, NULL, GL_DYNAMIC_DRAW);
+	capacity = wanted;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Shader.h"
+#include "GLState.h"
+#include "InstancedQuads.h"
+#include "RenderQueue.h"
+
+// one recorded draw; plain data so lists can be merged and sorted with memcpy-cheap moves
+struct DrawCommand
+{
+	uint64_t key;
+	Shader* shader;
+	unsigned int vao;
+	unsigned int texture;  // bound to unit 0, or 0 for shaders that index a TextureTable
+	GLuint count;
+	GLuint firstIndex;
+	GLint baseVertex;
+	uint32_t instance;     // index of the draw's QuadInstance in its CommandList
+};
+
+// Draws recorded by one thread. Lists are not locked: give every recording
+// thread its own (CommandBuffer::list(i)) and don't record while the
+// CommandBuffer submits.
+class CommandList
+{
+public:
+	// record count indices of vao's element buffer; layer orders first (lower draws first), depth in [0, 1] last
+	void draw(Shader& shader, unsigned int vao, unsigned int texture, const QuadInstance& data, unsigned int layer = 0,
+		float depth = 0.0f, GLuint count = 6, GLuint firstIndex = 0, GLint baseVertex = 0);
+	size_t size() const { return commands.size(); }
+	void clear();
+
+private:
+	friend class CommandBuffer;
+	std::vector<DrawCommand> commands;
+	std::vector<QuadInstance> instances;
+};
+
+// Frame command buffer: draws are recorded as DrawCommands carrying a 64-bit
+// sort key, merged from every CommandList, radix sorted and replayed. The key
+// holds, from the most significant bits down,
+//
+//     layer (8) | shader (12) | texture (14) | vao (12) | depth (18)
+//
+// so sorted commands come out grouped by program, then texture, then vertex
+// array, and replay changes each only when the group changes (GLState skips
+// the rest). Names wider than their field only weaken the grouping, the
+// command keeps the full values. Within a group depth sorts front to back.
+//
+// Replay uploads the sorted QuadInstance records in one buffer (binding
+// InstancedQuads::INSTANCE_BINDING) and issues one glMultiDrawElementsIndirect
+// per run of equal shader, texture and vao; each command's baseInstance is
+// its position in the sorted order, which BrickTexture.vs reads with
+// `instanced` set.
+class CommandBuffer
+{
+public:
+	explicit CommandBuffer(unsigned int threads = 1, size_t capacity = 1024);
+
+	// the list for recording thread index (0 <= index < listCount())
+	CommandList& list(unsigned int index) { return lists[index]; }
+	unsigned int listCount() const { return (unsigned int)lists.size(); }
+	// GL thread, after recording: merge, sort and draw every list, then clear them; returns the number of multi-draws
+	int submit();
+	void dispose();
+
+	static uint64_t makeKey(unsigned int layer, unsigned int shader, unsigned int texture, unsigned int vao, float depth);
+
+private:
+	struct SortEntry
+	{
+		uint64_t key;
+		uint32_t list;
+		uint32_t index;
+	};
+
+	std::vector<CommandList> lists;
+	std::vector<SortEntry> entries, scratch;
+	std::vector<DrawElementsIndirectCommand> indirect;
+	std::vector<QuadInstance> instances;
+	unsigned int commandBuffer;
+	unsigned int dataBuffer;
+	size_t commandCapacity, dataCapacity;  // bytes
+
+	// stable LSD radix sort on the key, 8 bits per pass; passes where every key has the same byte are skipped
+	static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+	static void reserve(unsigned int buffer, size_t& capacity, size_t size);
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// 128-bit hash of a block of bytes, used to identify images by content
+struct Hash128
+{
+	uint64_t low, high;
+
+	bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+	bool operator!=(const Hash128& other) const { return !(*this == other); }
+	// 32 lowercase hex digits, usable as a file name
+	std::string toString() const;
+};
+
+// lets Hash128 key unordered containers; the bits are already well mixed
+struct Hash128Hasher
+{
+	size_t operator()(const Hash128& hash) const { return (size_t)hash.low; }
+};
+
+// MurmurHash3 x64 128: processes 16 bytes per step, several GB/s on a single core
+Hash128 hashBytes(const void* data, size_t size, uint64_t seed = 0);
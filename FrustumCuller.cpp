@@ -0,0 +1,199 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_CULLER_SSE
+#include <emmintrin.h>
+#endif
+
+// groups of four per job when cull() runs on the job system; below this it stays on the calling thread
+static const size_t GROUPS_PER_JOB = 1024;
+
+FrustumCuller::FrustumCuller(size_t capacity)
+	: count(0)
+{
+	size_t padded = (capacity + 3) / 4 * 4;
+	cx.reserve(padded); cy.reserve(padded); cz.reserve(padded);
+	ex.reserve(padded); ey.reserve(padded); ez.reserve(padded);
+	radius.reserve(padded);
+}
+
+unsigned int FrustumCuller::add()
+{
+	if (count == cx.size())
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			cx.push_back(0.0f); cy.push_back(0.0f); cz.push_back(0.0f);
+			ex.push_back(0.0f); ey.push_back(0.0f); ez.push_back(0.0f);
+			radius.push_back(0.0f);
+		}
+	}
+	return (unsigned int)count++;
+}
+
+unsigned int FrustumCuller::addBox(const glm::vec3& min, const glm::vec3& max)
+{
+	unsigned int index = add();
+	setBox(index, min, max);
+	return index;
+}
+
+unsigned int FrustumCuller::addSphere(const glm::vec3& center, float r)
+{
+	unsigned int index = add();
+	setSphere(index, center, r);
+	return index;
+}
+
+void FrustumCuller::setBox(unsigned int index, const glm::vec3& min, const glm::vec3& max)
+{
+	cx[index] = (min.x + max.x) * 0.5f;
+	cy[index] = (min.y + max.y) * 0.5f;
+	cz[index] = (min.z + max.z) * 0.5f;
+	ex[index] = (max.x - min.x) * 0.5f;
+	ey[index] = (max.y - min.y) * 0.5f;
+	ez[index] = (max.z - min.z) * 0.5f;
+	radius[index] = std::sqrt(ex[index] * ex[index] + ey[index] * ey[index] + ez[index] * ez[index]);
+}
+
+void FrustumCuller::setBox(unsigned int index, const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform)
+{
+	glm::vec3 worldMin, worldMax;
+	transformBox(min, max, transform, worldMin, worldMax);
+	setBox(index, worldMin, worldMax);
+}
+
+void FrustumCuller::transformBox(const glm::vec3& min, const glm::vec3& max, const glm::mat4& m, glm::vec3& worldMin,
+	glm::vec3& worldMax)
+{
+	float center[3] = { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+	float extent[3] = { (max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f };
+	// the moved center, and per axis the reach of the three moved extent vectors
+	float worldCenter[3], worldExtent[3];
+	for (int r = 0; r < 3; r++)
+	{
+		worldCenter[r] = m[3][r];
+		worldExtent[r] = 0.0f;
+		for (int c = 0; c < 3; c++)
+		{
+			worldCenter[r] += m[c][r] * center[c];
+			worldExtent[r] += std::fabs(m[c][r]) * extent[c];
+		}
+	}
+	worldMin = glm::vec3(worldCenter[0] - worldExtent[0], worldCenter[1] - worldExtent[1], worldCenter[2] - worldExtent[2]);
+	worldMax = glm::vec3(worldCenter[0] + worldExtent[0], worldCenter[1] + worldExtent[1], worldCenter[2] + worldExtent[2]);
+}
+
+void FrustumCuller::setSphere(unsigned int index, const glm::vec3& center, float r)
+{
+	cx[index] = center.x;
+	cy[index] = center.y;
+	cz[index] = center.z;
+	ex[index] = ey[index] = ez[index] = r;
+	radius[index] = r;
+}
+
+void FrustumCuller::extractPlanes(const glm::mat4& m, glm::vec4 planes[6])
+{
+	// rows of the matrix: a point is inside when -w <= x, y, z <= w in clip space
+	for (int i = 0; i < 3; i++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			float s = side ? -1.0f : 1.0f;
+			glm::vec4 plane(m[0][3] + s * m[0][i], m[1][3] + s * m[1][i], m[2][3] + s * m[2][i], m[3][3] + s * m[3][i]);
+			float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+			if (length > 0.0f)
+				plane = glm::vec4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+			planes[i * 2 + side] = plane;
+		}
+	}
+}
+
+size_t FrustumCuller::cull(const glm::mat4& viewProjection, std::vector<unsigned int>& visible, JobSystem* jobs,
+	const OcclusionBuffer* occlusion)
+{
+	glm::vec4 planes[6];
+	extractPlanes(viewProjection, planes);
+	visible.clear();
+
+	size_t groups = (count + 3) / 4;
+	if (!jobs || groups <= GROUPS_PER_JOB)
+	{
+		cullGroups(0, groups, planes, viewProjection, occlusion, visible);
+		return visible.size();
+	}
+
+	// each chunk fills its own list, so the merged result keeps index order without sorting
+	chunks.resize((groups + GROUPS_PER_JOB - 1) / GROUPS_PER_JOB);
+	jobs->parallelFor(groups, GROUPS_PER_JOB, [&](size_t begin, size_t end)
+	{
+		std::vector<unsigned int>& out = chunks[begin / GROUPS_PER_JOB];
+		out.clear();
+		cullGroups(begin, end, planes, viewProjection, occlusion, out);
+	});
+	for (size_t i = 0; i < chunks.size(); i++)
+		visible.insert(visible.end(), chunks[i].begin(), chunks[i].end());
+	return visible.size();
+}
+
+void FrustumCuller::cullGroups(size_t first, size_t last, const glm::vec4 planes[6], const glm::mat4& viewProjection,
+	const OcclusionBuffer* occlusion, std::vector<unsigned int>& out) const
+{
+	for (size_t group = first; group < last; group++)
+	{
+		size_t base = group * 4;
+		int inside;
+#if defined(FRUSTUM_CULLER_SSE)
+		__m128 x = _mm_loadu_ps(&cx[base]), y = _mm_loadu_ps(&cy[base]), z = _mm_loadu_ps(&cz[base]);
+		__m128 extentX = _mm_loadu_ps(&ex[base]), extentY = _mm_loadu_ps(&ey[base]), extentZ = _mm_loadu_ps(&ez[base]);
+		__m128 r = _mm_loadu_ps(&radius[base]);
+		__m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			const glm::vec4& plane = planes[p];
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			// how far the box reaches towards the plane, capped by the sphere
+			__m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::fabs(plane.x))),
+				_mm_mul_ps(extentY, _mm_set1_ps(std::fabs(plane.y)))), _mm_mul_ps(extentZ, _mm_set1_ps(std::fabs(plane.z))));
+			reach = _mm_min_ps(reach, r);
+			mask = _mm_and_ps(mask, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+		}
+		inside = _mm_movemask_ps(mask);
+#else
+		inside = 0;
+		for (int lane = 0; lane < 4; lane++)
+		{
+			size_t i = base + lane;
+			bool in = true;
+			for (int p = 0; p < 6 && in; p++)
+			{
+				const glm::vec4& plane = planes[p];
+				float distance = cx[i] * plane.x + cy[i] * plane.y + cz[i] * plane.z + plane.w;
+				float reach = ex[i] * std::fabs(plane.x) + ey[i] * std::fabs(plane.y) + ez[i] * std::fabs(plane.z);
+				if (radius[i] < reach)
+					reach = radius[i];
+				in = distance + reach >= 0.0f;
+			}
+			if (in)
+				inside |= 1 << lane;
+		}
+#endif
+		if (!inside)
+			continue;
+
+		for (int lane = 0; lane < 4; lane++)
+		{
+			size_t i = base + lane;
+			if (!(inside & (1 << lane)) || i >= count)
+				continue;
+			if (occlusion && !occlusion->isVisible(viewProjection, glm::vec3(cx[i] - ex[i], cy[i] - ey[i], cz[i] - ez[i]),
+				glm::vec3(cx[i] + ex[i], cy[i] + ey[i], cz[i] + ez[i])))
+				continue;
+			out.push_back((unsigned int)i);
+		}
+	}
+}
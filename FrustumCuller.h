@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+#include "OcclusionBuffer.h"
+
+// Bounding volumes of many objects in structure-of-arrays layout (center x,
+// y, z, half extents x, y, z and sphere radius each in their own array), and
+// a frustum test that checks four objects per SSE instruction against the six
+// planes of a view-projection matrix.
+//
+// Every object has both a box and a sphere: boxes get their circumscribed
+// sphere, spheres their bounding cube. Per plane the test uses whichever of
+// the two reaches less far towards it, so either shape is culled as tightly as
+// its own test would. cull() walks the objects in parallel chunks on the
+// JobSystem and writes a compact, sorted list of visible indices for the draw
+// submission; with an OcclusionBuffer, survivors are also tested against it.
+class FrustumCuller
+{
+public:
+	explicit FrustumCuller(size_t capacity = 1024);
+
+	// add an object; returns its index, which stays valid (objects are never removed)
+	unsigned int addBox(const glm::vec3& min, const glm::vec3& max);
+	unsigned int addSphere(const glm::vec3& center, float radius);
+	void setBox(unsigned int index, const glm::vec3& min, const glm::vec3& max);
+	// the world space box around the local box [min, max] moved by transform
+	void setBox(unsigned int index, const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform);
+	void setSphere(unsigned int index, const glm::vec3& center, float radius);
+	size_t size() const { return count; }
+
+	// replace visible with the indices, in increasing order, of objects inside the frustum of viewProjection
+	// (GL clip space) and, if occlusion is given, not hidden in it. Returns the number of visible objects
+	size_t cull(const glm::mat4& viewProjection, std::vector<unsigned int>& visible, JobSystem* jobs = NULL,
+		const OcclusionBuffer* occlusion = NULL);
+
+	// the world space box around the local box [min, max] moved by transform
+	static void transformBox(const glm::vec3& min, const glm::vec3& max, const glm::mat4& transform, glm::vec3& worldMin,
+		glm::vec3& worldMax);
+	// the six frustum planes (left, right, bottom, top, near, far) as (normal, distance), normals pointing inwards
+	static void extractPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+private:
+	size_t count;
+	// padded to a multiple of four so every group loads four lanes; padding lanes are masked out
+	std::vector<float> cx, cy, cz;
+	std::vector<float> ex, ey, ez;
+	std::vector<float> radius;
+	std::vector<std::vector<unsigned int>> chunks;  // per-job results, concatenated in order
+
+	unsigned int add();
+	// append the visible objects of groups [first, last) of four to out
+	void cullGroups(size_t first, size_t last, const glm::vec4 planes[6], const glm::mat4& viewProjection,
+		const OcclusionBuffer* occlusion, std::vector<unsigned int>& out) const;
+};
@@ -0,0 +1,215 @@
+#include "GLState.h"
+
+#include <cstring>
+
+// GL never hands out this name, so it marks a shadow entry as unknown
+static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+static const int UNKNOWN_FLAG = -1;
+
+struct Shadow
+{
+	unsigned int program;
+	unsigned int vertexArray;
+	unsigned int textures[GLState::MAX_TEXTURE_UNITS];
+	int blend;
+	GLenum blendSource, blendDestination;
+	int depthTest;
+	int depthWrite;
+	GLenum depthFunc;
+	int viewport[4];
+	bool viewportKnown;
+
+	GLStateCounters current;
+	GLStateCounters last;
+
+	Shadow()
+	{
+		forget();
+		memset(&current, 0, sizeof(current));
+		memset(&last, 0, sizeof(last));
+	}
+
+	void forget()
+	{
+		program = vertexArray = UNKNOWN;
+		for (unsigned int i = 0; i < GLState::MAX_TEXTURE_UNITS; i++)
+			textures[i] = UNKNOWN;
+		blend = depthTest = depthWrite = UNKNOWN_FLAG;
+		blendSource = blendDestination = depthFunc = UNKNOWN;
+		viewportKnown = false;
+	}
+
+	void skipped(unsigned int& counter)
+	{
+		counter++;
+		current.elided++;
+	}
+};
+
+static Shadow state;
+
+void GLState::useProgram(unsigned int program)
+{
+	if (state.program == program)
+	{
+		state.skipped(state.current.elidedPrograms);
+		return;
+	}
+	glUseProgram(program);
+	state.program = program;
+	state.current.issued++;
+}
+
+void GLState::bindVertexArray(unsigned int vao)
+{
+	if (state.vertexArray == vao)
+	{
+		state.skipped(state.current.elidedVertexArrays);
+		return;
+	}
+	glBindVertexArray(vao);
+	state.vertexArray = vao;
+	state.current.issued++;
+}
+
+void GLState::bindTexture(unsigned int unit, unsigned int texture)
+{
+	if (unit < MAX_TEXTURE_UNITS)
+	{
+		if (state.textures[unit] == texture)
+		{
+			state.skipped(state.current.elidedTextures);
+			return;
+		}
+		state.textures[unit] = texture;
+	}
+	glBindTextureUnit(unit, texture);
+	state.current.issued++;
+}
+
+void GLState::setBlend(bool enabled)
+{
+	if (state.blend == (int)enabled)
+	{
+		state.skipped(state.current.elidedFixedFunction);
+		return;
+	}
+	if (enabled)
+		glEnable(GL_BLEND);
+	else
+		glDisable(GL_BLEND);
+	state.blend = enabled;
+	state.current.issued++;
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination)
+{
+	if (state.blendSource == source && state.blendDestination == destination)
+	{
+		state.skipped(state.current.elidedFixedFunction);
+		return;
+	}
+	glBlendFunc(source, destination);
+	state.blendSource = source;
+	state.blendDestination = destination;
+	state.current.issued++;
+}
+
+void GLState::setDepthTest(bool enabled)
+{
+	if (state.depthTest == (int)enabled)
+	{
+		state.skipped(state.current.elidedFixedFunction);
+		return;
+	}
+	if (enabled)
+		glEnable(GL_DEPTH_TEST);
+	else
+		glDisable(GL_DEPTH_TEST);
+	state.depthTest = enabled;
+	state.current.issued++;
+}
+
+void GLState::setDepthWrite(bool enabled)
+{
+	if (state.depthWrite == (int)enabled)
+	{
+		state.skipped(state.current.elidedFixedFunction);
+		return;
+	}
+	glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	state.depthWrite = enabled;
+	state.current.issued++;
+}
+
+void GLState::depthFunc(GLenum func)
+{
+	if (state.depthFunc == func)
+	{
+		state.skipped(state.current.elidedFixedFunction);
+		return;
+	}
+	glDepthFunc(func);
+	state.depthFunc = func;
+	state.current.issued++;
+}
+
+void GLState::viewport(int x, int y, int width, int height)
+{
+	if (state.viewportKnown && state.viewport[0] == x && state.viewport[1] == y && state.viewport[2] == width
+		&& state.viewport[3] == height)
+	{
+		state.skipped(state.current.elidedFixedFunction);
+		return;
+	}
+	glViewport(x, y, width, height);
+	state.viewport[0] = x;
+	state.viewport[1] = y;
+	state.viewport[2] = width;
+	state.viewport[3] = height;
+	state.viewportKnown = true;
+	state.current.issued++;
+}
+
+void GLState::programDeleted(unsigned int program)
+{
+	// a deleted current program stays in use until another is made current, but its name may come back
+	if (state.program == program)
+		state.program = UNKNOWN;
+}
+
+void GLState::vertexArrayDeleted(unsigned int vao)
+{
+	if (state.vertexArray == vao)
+		state.vertexArray = 0;
+}
+
+void GLState::textureDeleted(unsigned int texture)
+{
+	for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		if (state.textures[i] == texture)
+			state.textures[i] = 0;
+	}
+}
+
+void GLState::invalidate()
+{
+	state.forget();
+}
+
+const GLStateCounters& GLState::counters()
+{
+	return state.current;
+}
+
+const GLStateCounters& GLState::lastFrame()
+{
+	return state.last;
+}
+
+void GLState::endFrame()
+{
+	state.last = state.current;
+	memset(&state.current, 0, sizeof(state.current));
+}
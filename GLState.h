@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// calls counted since the last GLState::endFrame()
+struct GLStateCounters
+{
+	unsigned int issued;          // calls that reached GL
+	unsigned int elided;          // calls skipped because the state already matched, all kinds
+	unsigned int elidedPrograms;
+	unsigned int elidedVertexArrays;
+	unsigned int elidedTextures;
+	unsigned int elidedFixedFunction;  // blend, depth and viewport
+};
+
+// Shadow of the GL state the renderer changes most: current program, bound
+// vertex array, the texture on each unit, blend and depth state and the
+// viewport. Every setter compares against the shadow and only calls GL when
+// the value changes, so code can say what it needs before each draw without
+// paying for driver state validation on calls that change nothing.
+//
+// The shadow starts unknown, so the first call of each kind always goes
+// through. Code that changes this state behind the cache's back must call
+// invalidate(). GL thread only.
+class GLState
+{
+public:
+	// units above this are bound without shadowing
+	static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+	static void useProgram(unsigned int program);
+	static void bindVertexArray(unsigned int vao);
+	// glBindTextureUnit: binds to the target the texture was created for, no glActiveTexture needed
+	static void bindTexture(unsigned int unit, unsigned int texture);
+	static void setBlend(bool enabled);
+	static void blendFunc(GLenum source, GLenum destination);
+	static void setDepthTest(bool enabled);
+	static void setDepthWrite(bool enabled);
+	static void depthFunc(GLenum func);
+	static void viewport(int x, int y, int width, int height);
+
+	// GL unbinds deleted objects; forget them so a reused name is bound again
+	static void programDeleted(unsigned int program);
+	static void vertexArrayDeleted(unsigned int vao);
+	static void textureDeleted(unsigned int texture);
+	// mark everything unknown, e.g. after a library touched GL state directly
+	static void invalidate();
+
+	// counters of the frame in progress
+	static const GLStateCounters& counters();
+	// counters of the last finished frame
+	static const GLStateCounters& lastFrame();
+	// call once per frame, after the last draw: keeps the frame's counters and starts new ones
+	static void endFrame();
+};
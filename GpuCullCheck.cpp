@@ -0,0 +1,174 @@
+// Headless check of GpuCuller for software GL drivers such as Mesa's llvmpipe:
+// no window, just a surfaceless EGL context. For the count draw path and the
+// zero-filled fallback it checks that Cull.comp selects exactly the objects
+// FrustumCuller keeps and writes well-formed commands for them, then that the
+// Hi-Z test never culls an object that is in front of the depth buffer.
+//
+// It has its own main(), so it is not part of the Visual Studio build. On
+// Linux, from the repository root, with the glad and glm headers on the
+// include path:
+//
+//   g++ -std=c++14 GpuCullCheck.cpp GpuCuller.cpp FrustumCuller.cpp OcclusionBuffer.cpp JobSystem.cpp
+//       Shader.cpp GLState.cpp Texture.cpp glad.c -lEGL -ldl -pthread -o gpucullcheck
+//   LIBGL_ALWAYS_SOFTWARE=1 ./gpucullcheck
+//
+// Prints a line per check and exits with 1 if any failed.
+#include "GpuCuller.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static const int OBJECTS = 3000;
+static const float HALF_SIZE = 0.01f;
+// odd on purpose: the Hi-Z levels round down and fold the extra texel into the last one
+static const int DEPTH_WIDTH = 253, DEPTH_HEIGHT = 123;
+
+struct Scene
+{
+	std::vector<glm::vec3> centers;
+	std::vector<unsigned int> visible;  // FrustumCuller's answer for the identity view-projection
+};
+
+static bool createContext()
+{
+	EGLDisplay display = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cout << "ERROR::GPU_CULL_CHECK::NO_EGL_DISPLAY" << std::endl;
+		return false;
+	}
+
+	// 4.6 where the driver has it, llvmpipe stops at 4.5 (the compute shaders only need 4.3)
+	EGLContext context = EGL_NO_CONTEXT;
+	for (int minor = 6; minor >= 5 && context == EGL_NO_CONTEXT; minor--)
+	{
+		EGLint attributes[] = { EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+		context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+	}
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cout << "ERROR::GPU_CULL_CHECK::NO_GL_CONTEXT" << std::endl;
+		return false;
+	}
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return false;
+	}
+	std::cout << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+	return true;
+}
+
+// small boxes at z = 0 scattered over twice the clip space square, so about a quarter are visible
+static void buildScene(Scene& scene, GpuCuller& culler)
+{
+	FrustumCuller reference(OBJECTS);
+	srand(5);
+	for (int i = 0; i < OBJECTS; i++)
+	{
+		float x = rand() / (float)RAND_MAX * 4.0f - 2.0f;
+		float y = rand() / (float)RAND_MAX * 4.0f - 2.0f;
+		glm::vec3 min(x - HALF_SIZE, y - HALF_SIZE, 0.0f), max(x + HALF_SIZE, y + HALF_SIZE, 0.0f);
+		scene.centers.push_back(glm::vec3(x, y, 0.0f));
+		culler.add(min, max);
+		reference.addBox(min, max);
+	}
+	reference.cull(glm::mat4(1.0f), scene.visible);
+}
+
+// the objects the last cull() selected, in increasing order; false if a command is malformed
+static bool drawnObjects(const GpuCuller& culler, std::vector<unsigned int>& drawn)
+{
+	std::vector<DrawElementsIndirectCommand> commands;
+	culler.readCommands(commands);
+	drawn.clear();
+	bool wellFormed = true;
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const DrawElementsIndirectCommand& command = commands[i];
+		wellFormed = wellFormed && command.count == 6 && command.instanceCount == 1 && command.firstIndex == 0
+			&& command.baseVertex == 0 && command.baseInstance < OBJECTS;
+		drawn.push_back(command.baseInstance);
+	}
+	std::sort(drawn.begin(), drawn.end());
+	return wellFormed && std::adjacent_find(drawn.begin(), drawn.end()) == drawn.end();
+}
+
+static bool report(const char* check, bool passed)
+{
+	std::cout << (passed ? "ok     " : "FAILED ") << check << std::endl;
+	return passed;
+}
+
+// frustum culling against FrustumCuller, then Hi-Z culling against a depth buffer that
+// is near (0.3) on its left half and empty (1.0) on its right half
+static bool checkPath(GLADloadproc loader)
+{
+	GpuCuller culler(OBJECTS, loader);
+	std::cout << (culler.drawsWithCount() ? "glMultiDrawElementsIndirectCount path" : "glMultiDrawElementsIndirect fallback")
+		<< std::endl;
+	Scene scene;
+	buildScene(scene, culler);
+
+	bool passed = true;
+	std::vector<unsigned int> drawn;
+	culler.cull(glm::mat4(1.0f));
+	passed &= report("frustum: commands are well formed", drawnObjects(culler, drawn));
+	passed &= report("frustum: same objects as FrustumCuller", drawn == scene.visible);
+
+	unsigned int depth;
+	glCreateTextures(GL_TEXTURE_2D, 1, &depth);
+	glTextureStorage2D(depth, 1, GL_DEPTH_COMPONENT32F, DEPTH_WIDTH, DEPTH_HEIGHT);
+	std::vector<float> depths((size_t)DEPTH_WIDTH * DEPTH_HEIGHT);
+	for (int y = 0; y < DEPTH_HEIGHT; y++)
+	{
+		for (int x = 0; x < DEPTH_WIDTH; x++)
+			depths[(size_t)y * DEPTH_WIDTH + x] = x < DEPTH_WIDTH / 2 ? 0.3f : 1.0f;
+	}
+	glTextureSubImage2D(depth, 0, 0, 0, DEPTH_WIDTH, DEPTH_HEIGHT, GL_DEPTH_COMPONENT, GL_FLOAT, depths.data());
+	culler.buildHiZ(depth, DEPTH_WIDTH, DEPTH_HEIGHT);
+	// the boxes sit at depth 0.5: hidden on the left half, visible wherever they reach into the right one
+	culler.cull(glm::mat4(1.0f), true);
+	passed &= report("hi-z: commands are well formed", drawnObjects(culler, drawn));
+
+	size_t falselyCulled = 0;
+	for (size_t i = 0; i < scene.visible.size(); i++)
+	{
+		unsigned int object = scene.visible[i];
+		float right = ((scene.centers[object].x + HALF_SIZE) * 0.5f + 0.5f) * DEPTH_WIDTH;
+		// a little margin keeps boxes ending right on the boundary out of it
+		if (right > DEPTH_WIDTH / 2 + 0.01f && !std::binary_search(drawn.begin(), drawn.end(), object))
+			falselyCulled++;
+	}
+	passed &= report("hi-z: nothing in front of the depth buffer is culled", falselyCulled == 0);
+	passed &= report("hi-z: objects behind the depth buffer are culled", drawn.size() < scene.visible.size());
+	std::cout << "       " << scene.visible.size() << " in the frustum, " << drawn.size() << " after hi-z, "
+		<< falselyCulled << " culled wrongly" << std::endl;
+
+	GLState::textureDeleted(depth);
+	glDeleteTextures(1, &depth);
+	culler.dispose();
+	passed &= report("no GL errors", glGetError() == GL_NO_ERROR);
+	return passed;
+}
+
+int main()
+{
+	if (!createContext())
+		return 1;
+	bool passed = checkPath((GLADloadproc)eglGetProcAddress);
+	// no loader: the zero-filled fallback for drivers without indirect count draws
+	passed &= checkPath(NULL);
+	std::cout << (passed ? "all checks passed" : "ERROR::GPU_CULL_CHECK::FAILED") << std::endl;
+	return passed ? 0 : 1;
+}
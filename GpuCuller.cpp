@@ -0,0 +1,226 @@
+#include "GpuCuller.h"
+
+#include <cmath>
+
+// Cull.comp's local_size_x
+static const GLuint CULL_GROUP_SIZE = 64;
+// HiZ.comp's local_size_x and local_size_y
+static const GLuint HIZ_GROUP_SIZE = 8;
+
+GpuCuller::GpuCuller(size_t capacity, GLADloadproc loader)
+	: cullProgram("./Cull.comp"), hiZProgram("./HiZ.comp"), multiDrawCount(NULL), dirtyBegin(0), dirtyEnd(0),
+	objectBuffer(0), commandBuffer(0), countBuffer(0), capacity(0), hiZ(0), hiZWidth(0), hiZHeight(0), hiZLevels(0)
+{
+	if (loader)
+	{
+		// core in 4.6, the ARB entry point before that
+		multiDrawCount = (MultiDrawElementsIndirectCountProc)loader("glMultiDrawElementsIndirectCount");
+		if (!multiDrawCount && Texture::hasExtension("GL_ARB_indirect_parameters"))
+			multiDrawCount = (MultiDrawElementsIndirectCountProc)loader("glMultiDrawElementsIndirectCountARB");
+	}
+
+	objectCountLoc = glGetUniformLocation(cullProgram.ID, "objectCount");
+	planesLoc = glGetUniformLocation(cullProgram.ID, "planes");
+	viewProjectionLoc = glGetUniformLocation(cullProgram.ID, "viewProjection");
+	occlusionLoc = glGetUniformLocation(cullProgram.ID, "occlusion");
+	hiZLoc = glGetUniformLocation(cullProgram.ID, "hiZ");
+	fromDepthLoc = glGetUniformLocation(hiZProgram.ID, "fromDepth");
+	depthLoc = glGetUniformLocation(hiZProgram.ID, "depth");
+
+	glCreateBuffers(1, &objectBuffer);
+	glCreateBuffers(1, &commandBuffer);
+	glCreateBuffers(1, &countBuffer);
+	glNamedBufferStorage(countBuffer, sizeof(GLuint), NULL, GL_DYNAMIC_STORAGE_BIT);
+	objects.reserve(capacity);
+	reserve(capacity ? capacity : 1);
+}
+
+unsigned int GpuCuller::add(const glm::vec3& min, const glm::vec3& max, GLuint count, GLuint firstIndex, GLint baseVertex)
+{
+	GpuCullObject object;
+	computeBox(min, max, object);
+	object.count = count;
+	object.firstIndex = firstIndex;
+	object.baseVertex = baseVertex;
+	object.padding = 0;
+	objects.push_back(object);
+	markDirty(objects.size() - 1);
+	return (unsigned int)(objects.size() - 1);
+}
+
+void GpuCuller::setBounds(unsigned int index, const glm::vec3& min, const glm::vec3& max)
+{
+	computeBox(min, max, objects[index]);
+	markDirty(index);
+}
+
+void GpuCuller::computeBox(const glm::vec3& min, const glm::vec3& max, GpuCullObject& object)
+{
+	glm::vec3 extents((max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f);
+	float radius = std::sqrt(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+	object.center = glm::vec4((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f, radius);
+	object.extents = glm::vec4(extents, 0.0f);
+}
+
+void GpuCuller::markDirty(size_t index)
+{
+	if (dirtyBegin == dirtyEnd)
+	{
+		dirtyBegin = index;
+		dirtyEnd = index + 1;
+		return;
+	}
+	if (index < dirtyBegin)
+		dirtyBegin = index;
+	if (index + 1 > dirtyEnd)
+		dirtyEnd = index + 1;
+}
+
+void GpuCuller::reserve(size_t wanted)
+{
+	size_t grown = capacity ? capacity : 1;
+	while (grown < wanted)
+		grown *= 2;
+	if (grown == capacity)
+		return;
+	capacity = grown;
+	glNamedBufferData(objectBuffer, capacity * sizeof(GpuCullObject), NULL, GL_DYNAMIC_DRAW);
+	glNamedBufferData(commandBuffer, capacity * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+	// the new storage holds nothing yet
+	if (!objects.empty())
+	{
+		dirtyBegin = 0;
+		dirtyEnd = objects.size();
+	}
+}
+
+void GpuCuller::buildHiZ(unsigned int depthTexture, int width, int height)
+{
+	if (width != hiZWidth || height != hiZHeight)
+	{
+		if (hiZ)
+		{
+			GLState::textureDeleted(hiZ);
+			glDeleteTextures(1, &hiZ);
+		}
+		hiZWidth = width;
+		hiZHeight = height;
+		hiZLevels = Texture::mipLevels(width, height);
+		glCreateTextures(GL_TEXTURE_2D, 1, &hiZ);
+		glTextureStorage2D(hiZ, hiZLevels, GL_R32F, width, height);
+		glTextureParameteri(hiZ, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTextureParameteri(hiZ, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	}
+
+	hiZProgram.use();
+	glUniform1i(depthLoc, HIZ_UNIT);
+	GLState::bindTexture(HIZ_UNIT, depthTexture);
+	for (int level = 0; level < hiZLevels; level++)
+	{
+		int w = Texture::levelDimension(width, level), h = Texture::levelDimension(height, level);
+		glUniform1i(fromDepthLoc, level == 0);
+		if (level > 0)
+			glBindImageTexture(0, hiZ, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		glBindImageTexture(1, hiZ, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((w + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (h + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+		// the next level reads this one
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+void GpuCuller::cull(const glm::mat4& viewProjection, bool occlusion)
+{
+	reserve(objects.size());
+	if (dirtyEnd > dirtyBegin)
+	{
+		glNamedBufferSubData(objectBuffer, dirtyBegin * sizeof(GpuCullObject), (dirtyEnd - dirtyBegin) * sizeof(GpuCullObject),
+			&objects[dirtyBegin]);
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	GLuint zero = 0;
+	glClearNamedBufferData(countBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	if (!multiDrawCount)
+		glClearNamedBufferData(commandBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	if (objects.empty())
+		return;
+
+	glm::vec4 planes[6];
+	FrustumCuller::extractPlanes(viewProjection, planes);
+	if (occlusion && !hiZ)
+	{
+		std::cout << "ERROR::GPU_CULLER::NO_HIZ occlusion culling needs buildHiZ() first" << std::endl;
+		occlusion = false;
+	}
+
+	cullProgram.use();
+	glUniform1ui(objectCountLoc, (GLuint)objects.size());
+	glUniform4fv(planesLoc, 6, glm::value_ptr(planes[0]));
+	glUniformMatrix4fv(viewProjectionLoc, 1, GL_FALSE, glm::value_ptr(viewProjection));
+	glUniform1i(occlusionLoc, occlusion);
+	glUniform1i(hiZLoc, HIZ_UNIT);
+	if (occlusion)
+		GLState::bindTexture(HIZ_UNIT, hiZ);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BINDING, objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BINDING, countBuffer);
+	glDispatchCompute(((GLuint)objects.size() + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	// draw() reads the commands and the count as indirect parameters
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCuller::draw(Shader& shader, unsigned int vao)
+{
+	if (objects.empty())
+		return;
+	shader.use();
+	shader.setBool("instanced", true);
+	shader.setBool("indirect", false);
+	GLState::bindVertexArray(vao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	if (multiDrawCount)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER, countBuffer);
+		multiDrawCount(GL_TRIANGLES, GL_UNSIGNED_INT, 0, 0, (GLsizei)objects.size(), 0);
+		glBindBuffer(GL_PARAMETER_BUFFER, 0);
+	}
+	else
+	{
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, (GLsizei)objects.size(), 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	shader.setBool("instanced", false);
+}
+
+GLuint GpuCuller::visibleCount() const
+{
+	GLuint count = 0;
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(countBuffer, 0, sizeof(GLuint), &count);
+	return count;
+}
+
+void GpuCuller::readCommands(std::vector<DrawElementsIndirectCommand>& commands) const
+{
+	commands.resize(visibleCount());
+	if (!commands.empty())
+		glGetNamedBufferSubData(commandBuffer, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+}
+
+void GpuCuller::dispose()
+{
+	cullProgram.dispose();
+	hiZProgram.dispose();
+	glDeleteBuffers(1, &objectBuffer);
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteBuffers(1, &countBuffer);
+	objectBuffer = commandBuffer = countBuffer = 0;
+	if (hiZ)
+	{
+		GLState::textureDeleted(hiZ);
+		glDeleteTextures(1, &hiZ);
+		hiZ = 0;
+	}
+	objects.clear();
+}
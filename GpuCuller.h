@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Shader.h"
+#include "GLState.h"
+#include "Texture.h"
+#include "RenderQueue.h"
+#include "FrustumCuller.h"
+
+// one object as Cull.comp reads it, std430 layout of its Object struct
+struct GpuCullObject
+{
+	glm::vec4 center;   // xyz box center, w bounding sphere radius
+	glm::vec4 extents;  // xyz box half extents
+	GLuint count;       // the draw emitted when the object is visible
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint padding;
+};
+
+// GPU-driven culling. Object bounds and draws live in a shader storage buffer
+// that is only written when objects are added or moved; every frame Cull.comp
+// tests all of them against the frustum (and optionally a Hi-Z pyramid of the
+// previous frame's depth) and atomically appends a DrawElementsIndirectCommand
+// per visible object, and draw() submits the result with one
+// glMultiDrawElementsIndirectCount whose draw count the GPU wrote itself. The
+// CPU never reads or writes per-object data in a frame where nothing moved.
+//
+// Each command's baseInstance is the object's index, so BrickTexture.vs with
+// `instanced` set (and `indirect` clear) reads the object's QuadInstance from
+// the buffer the caller binds at InstancedQuads::INSTANCE_BINDING. Visible
+// objects are drawn in no particular order.
+//
+// Without GL 4.6 or GL_ARB_indirect_parameters the command buffer is cleared
+// every frame and drawn whole with glMultiDrawElementsIndirect; the
+// zero-count commands past the survivors draw nothing.
+class GpuCuller
+{
+public:
+	// shader storage bindings of Cull.comp
+	static const unsigned int OBJECT_BINDING = 2;
+	static const unsigned int COMMAND_BINDING = 3;
+	static const unsigned int COUNT_BINDING = 4;
+	// texture unit the Hi-Z pyramid and the depth buffer are read from
+	static const unsigned int HIZ_UNIT = 15;
+
+	// loader resolves glMultiDrawElementsIndirectCount; NULL always takes the fallback
+	explicit GpuCuller(size_t capacity = 1024, GLADloadproc loader = NULL);
+
+	// add an object with the world space box [min, max], drawn as count indices from firstIndex; returns its index
+	unsigned int add(const glm::vec3& min, const glm::vec3& max, GLuint count = 6, GLuint firstIndex = 0, GLint baseVertex = 0);
+	void setBounds(unsigned int index, const glm::vec3& min, const glm::vec3& max);
+	size_t size() const { return objects.size(); }
+
+	// rebuild the Hi-Z pyramid from a depth texture (width x height); call after the depth is final, before cull()
+	void buildHiZ(unsigned int depthTexture, int width, int height);
+	// upload changed objects, run Cull.comp and leave the commands for draw(); occlusion needs buildHiZ()
+	void cull(const glm::mat4& viewProjection, bool occlusion = false);
+	// draw the visible objects with shader (BrickTexture.vs) and vao
+	void draw(Shader& shader, unsigned int vao);
+	// read back how many objects passed the last cull(); waits for the GPU, for tests and statistics only
+	GLuint visibleCount() const;
+	// read back the commands the last cull() appended, in the order the GPU wrote them; for tests only
+	void readCommands(std::vector<DrawElementsIndirectCommand>& commands) const;
+	bool drawsWithCount() const { return multiDrawCount != NULL; }
+	void dispose();
+
+private:
+	typedef void (APIENTRYP MultiDrawElementsIndirectCountProc)(GLenum mode, GLenum type, const void* indirect,
+		GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride);
+
+	Shader cullProgram;
+	Shader hiZProgram;
+	MultiDrawElementsIndirectCountProc multiDrawCount;
+	std::vector<GpuCullObject> objects;
+	size_t dirtyBegin, dirtyEnd;  // objects changed since the last upload
+	unsigned int objectBuffer, commandBuffer, countBuffer;
+	size_t capacity;              // objects the buffers hold
+	unsigned int hiZ;
+	int hiZWidth, hiZHeight, hiZLevels;
+	int objectCountLoc, planesLoc, viewProjectionLoc, occlusionLoc, hiZLoc;
+	int fromDepthLoc, depthLoc;
+
+	void markDirty(size_t index);
+	// make room for wanted objects; the object buffer is re-filled from objects
+	void reserve(size_t wanted);
+	static void computeBox(const glm::vec3& min, const glm::vec3& max, GpuCullObject& object);
+};
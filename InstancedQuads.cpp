@@ -0,0 +1,33 @@
+#include "InstancedQuads.h"
+
+InstancedQuads::InstancedQuads(size_t capacity)
+	: buffer(0), capacity(capacity ? capacity : 1)
+{
+	glCreateBuffers(1, &buffer);
+	glNamedBufferData(buffer, this->capacity * sizeof(QuadInstance), NULL, GL_DYNAMIC_DRAW);
+}
+
+void InstancedQuads::draw(Shader& shader, unsigned int vao, int indexCount)
+{
+	if (instances.empty())
+		return;
+
+	while (capacity < instances.size())
+		capacity *= 2;
+	// orphan the old storage so the upload doesn't wait for draws still reading last frame's instances
+	glNamedBufferData(buffer, capacity * sizeof(QuadInstance), NULL, GL_DYNAMIC_DRAW);
+	glNamedBufferSubData(buffer, 0, instances.size() * sizeof(QuadInstance), instances.data());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING, buffer);
+
+	shader.use();
+	shader.setBool("instanced", true);
+	GLState::bindVertexArray(vao);
+	glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, (GLsizei)instances.size());
+	shader.setBool("instanced", false);
+}
+
+void InstancedQuads::dispose()
+{
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+
+// per-instance data read by BrickTexture.vs, std430 layout of its Instance struct
+struct QuadInstance
+{
+	glm::mat4 transform;
+	int texture1, texture2;  // TextureTable indices
+	float mixFactor;
+	float padding;
+};
+
+// Draws many copies of an indexed mesh (the textured quad) with one
+// glDrawElementsInstanced. Instances are collected on the CPU, uploaded to a
+// shader storage buffer in one go and fetched by BrickTexture.vs with
+// gl_InstanceID while its `instanced` uniform is set, so the cost of a
+// quad's transform, textures and blend is a store instead of a draw call.
+class InstancedQuads
+{
+public:
+	// shader storage binding of the Instances block in BrickTexture.vs
+	static const unsigned int INSTANCE_BINDING = 1;
+
+	explicit InstancedQuads(size_t capacity = 1024);
+
+	void clear() { instances.clear(); }
+	void add(const QuadInstance& instance) { instances.push_back(instance); }
+	size_t size() const { return instances.size(); }
+	// upload the instances and draw them all with the bound shader; vao supplies the mesh and its element buffer
+	void draw(Shader& shader, unsigned int vao, int indexCount);
+	void dispose();
+
+private:
+	unsigned int buffer;
+	size_t capacity;  // instances the buffer can hold
+	std::vector<QuadInstance> instances;
+};
@@ -0,0 +1,285 @@
+#include "JobSystem.h"
+
+struct JobCounter::Job
+{
+	std::function<void()> function;
+	JobCounter* counter;
+};
+
+// index of the calling thread's deque, -1 outside the pool; pools don't nest, so one slot per thread is enough
+static thread_local int workerIndex = -1;
+static thread_local JobSystem* workerPool = NULL;
+
+JobCounter::JobCounter()
+	: pending(0)
+{
+}
+
+JobSystem::WorkDeque::WorkDeque()
+	: top(0), bottom(0)
+{
+	for (int64_t i = 0; i < CAPACITY; i++)
+		slots[i].store(NULL, std::memory_order_relaxed);
+}
+
+bool JobSystem::WorkDeque::push(JobCounter::Job* job)
+{
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY)
+		return false;
+	slots[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+JobCounter::Job* JobSystem::WorkDeque::pop()
+{
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	if (t > b)
+	{
+		// empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return NULL;
+	}
+	JobCounter::Job* job = slots[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// the last job: race the thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = NULL;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+JobCounter::Job* JobSystem::WorkDeque::steal()
+{
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return NULL;
+	JobCounter::Job* job = slots[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return NULL;
+	return job;
+}
+
+JobSystem::JobSystem(unsigned int threads)
+	: queued(0), sleeping(0), stopping(false)
+{
+	if (threads == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		threads = cores > 1 ? cores - 1 : 1;
+	}
+	for (unsigned int i = 0; i < threads; i++)
+		deques.emplace_back(new WorkDeque());
+	for (unsigned int i = 0; i < threads; i++)
+		workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	dispose();
+}
+
+void JobSystem::run(const std::function<void()>& function, JobCounter* counter, JobCounter* dependency)
+{
+	JobCounter::Job* job = new JobCounter::Job();
+	job->function = function;
+	job->counter = counter;
+	if (counter)
+		counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	if (dependency)
+	{
+		// the lock orders this against the last job of the dependency releasing its waiters
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if (!dependency->done())
+		{
+			dependency->waiting.push_back(job);
+			return;
+		}
+	}
+	schedule(job);
+}
+
+// chunks of one parallelFor; helper jobs still queued when it returns find nothing left and only touch this
+struct ParallelForChunks
+{
+	const std::function<void(size_t, size_t)>* body;
+	size_t count, grain, chunks;
+	std::atomic<size_t> next;      // next chunk to claim
+	std::atomic<size_t> finished;  // chunks done
+};
+
+static void runChunks(ParallelForChunks& work)
+{
+	for (;;)
+	{
+		size_t chunk = work.next.fetch_add(1, std::memory_order_relaxed);
+		if (chunk >= work.chunks)
+			return;
+		size_t begin = chunk * work.grain;
+		(*work.body)(begin, begin + work.grain < work.count ? begin + work.grain : work.count);
+		work.finished.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void JobSystem::parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& body)
+{
+	if (grain == 0)
+		grain = 1;
+	std::shared_ptr<ParallelForChunks> work = std::make_shared<ParallelForChunks>();
+	work->body = &body;
+	work->count = count;
+	work->grain = grain;
+	work->chunks = (count + grain - 1) / grain;
+	work->next.store(0, std::memory_order_relaxed);
+	work->finished.store(0, std::memory_order_relaxed);
+
+	// helpers claim chunks until none are left; the caller claims them too, so it never waits on an unrelated job
+	size_t helpers = work->chunks > 1 ? work->chunks - 1 : 0;
+	if (helpers > workers.size())
+		helpers = workers.size();
+	for (size_t i = 0; i < helpers; i++)
+		run([work] { runChunks(*work); });
+	runChunks(*work);
+	// only chunks already running on other threads are left
+	while (work->finished.load(std::memory_order_acquire) < work->chunks)
+		std::this_thread::yield();
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	while (!counter.done())
+	{
+		JobCounter::Job* job = take();
+		if (job)
+			execute(job);
+		else
+			std::this_thread::yield();
+	}
+	// the job that finished the counter may still hold its lock; the caller is free to destroy it after this
+	std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::dispose()
+{
+	if (workers.empty())
+		return;
+	// workers drain the queues before they look at stopping
+	stopping.store(true, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_all();
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+	// jobs queued after the workers left run here
+	while (JobCounter::Job* job = take())
+		execute(job);
+}
+
+void JobSystem::workerLoop(unsigned int index)
+{
+	workerIndex = (int)index;
+	workerPool = this;
+	for (;;)
+	{
+		JobCounter::Job* job = take();
+		if (job)
+		{
+			execute(job);
+			continue;
+		}
+		if (stopping.load(std::memory_order_acquire) && queued.load(std::memory_order_acquire) == 0)
+			return;
+
+		// seq_cst pairs with schedule(): either this sees the new queued count or schedule() sees the
+		// sleeper and notifies under sleepMutex, so a job queued after the failed take() is never missed
+		sleeping.fetch_add(1, std::memory_order_seq_cst);
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [this]
+			{
+				return queued.load(std::memory_order_seq_cst) > 0 || stopping.load(std::memory_order_acquire);
+			});
+		}
+		sleeping.fetch_sub(1, std::memory_order_relaxed);
+	}
+}
+
+void JobSystem::schedule(JobCounter::Job* job)
+{
+	queued.fetch_add(1, std::memory_order_seq_cst);
+	bool own = workerPool == this && workerIndex >= 0;
+	if (!own || !deques[workerIndex]->push(job))
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		shared.push_back(job);
+	}
+	if (sleeping.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+}
+
+JobCounter::Job* JobSystem::take()
+{
+	JobCounter::Job* job = NULL;
+	int self = workerPool == this ? workerIndex : -1;
+	if (self >= 0)
+		job = deques[self]->pop();
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		if (!shared.empty())
+		{
+			job = shared.front();
+			shared.pop_front();
+		}
+	}
+	if (!job && !deques.empty())
+	{
+		// start at a different victim per thread so thieves don't all hit the same deque
+		size_t count = deques.size();
+		size_t start = self >= 0 ? (size_t)self + 1 : (size_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+		for (size_t i = 0; i < count && !job; i++)
+		{
+			size_t victim = (start + i) % count;
+			if ((int)victim != self)
+				job = deques[victim]->steal();
+		}
+	}
+	if (job)
+		queued.fetch_sub(1, std::memory_order_acq_rel);
+	return job;
+}
+
+void JobSystem::execute(JobCounter::Job* job)
+{
+	job->function();
+	JobCounter* counter = job->counter;
+	delete job;
+	if (!counter)
+		return;
+
+	// hold the lock while finishing so run() can't queue a waiter that is never released
+	std::vector<JobCounter::Job*> released;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			released.swap(counter->waiting);
+	}
+	for (size_t i = 0; i < released.size(); i++)
+		schedule(released[i]);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem;
+
+// Counts unfinished jobs. Jobs started with a counter increment it and
+// decrement it when done; JobSystem::wait() runs other jobs until it reaches
+// zero, and jobs started with it as their dependency are held back until then.
+class JobCounter
+{
+public:
+	JobCounter();
+	bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+	struct Job;
+
+	std::atomic<int> pending;
+	std::mutex mutex;
+	std::vector<Job*> waiting;  // jobs depending on this counter, started when it reaches zero
+};
+
+// Fixed pool of worker threads, one per core minus the calling thread by
+// default, each with its own work-stealing deque (Chase-Lev): a worker
+// pushes and pops jobs at the bottom of its own deque, which stays in its
+// cache and needs no lock, and idle workers steal from the top of the
+// others'. Jobs started from threads outside the pool go through a shared
+// queue. Waiting on a counter never idles the waiting thread, it runs queued
+// jobs until the counter drops to zero, so jobs may wait on jobs they spawn.
+//
+// Jobs should not block on anything but JobSystem::wait(); a job that sleeps
+// on a condition variable holds its worker for that long.
+class JobSystem
+{
+public:
+	// threads = 0: one worker per hardware thread, leaving one for the caller
+	explicit JobSystem(unsigned int threads = 0);
+	~JobSystem();
+
+	// start job; counter (optional) counts it as pending until it returns, and a non-null
+	// dependency holds it back until that counter is done
+	void run(const std::function<void()>& job, JobCounter* counter = NULL, JobCounter* dependency = NULL);
+	// run body(begin, end) over [0, count) in chunks of at most grain items, and wait for all of them. While
+	// waiting the caller only runs chunks of this call, never other queued jobs, so a frame that splits its
+	// culling this way can't be held up by an unrelated job such as an image decode
+	void parallelFor(size_t count, size_t grain, const std::function<void(size_t begin, size_t end)>& body);
+	// run queued jobs on this thread until counter is done
+	void wait(JobCounter& counter);
+	unsigned int workerCount() const { return (unsigned int)workers.size(); }
+	// finish every queued job and join the workers
+	void dispose();
+
+private:
+	// Chase-Lev deque of fixed capacity: push/pop by the owning worker, steal by anyone
+	class WorkDeque
+	{
+	public:
+		static const int64_t CAPACITY = 4096;
+
+		WorkDeque();
+		bool push(JobCounter::Job* job);
+		JobCounter::Job* pop();
+		JobCounter::Job* steal();
+
+	private:
+		std::atomic<int64_t> top;
+		std::atomic<int64_t> bottom;
+		std::atomic<JobCounter::Job*> slots[CAPACITY];
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<WorkDeque>> deques;
+	std::mutex sharedMutex;
+	std::deque<JobCounter::Job*> shared;  // jobs from threads outside the pool
+	std::atomic<int> queued;              // jobs in any deque or the shared queue
+	std::atomic<int> sleeping;
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<bool> stopping;
+
+	void workerLoop(unsigned int index);
+	// put a job whose dependency is done on this thread's deque, or the shared queue
+	void schedule(JobCounter::Job* job);
+	// take one job from this thread's deque, the shared queue or another worker
+	JobCounter::Job* take();
+	void execute(JobCounter::Job* job);
+};
@@ -2,7 +2,19 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include "Shader.h"
+#include "TextureStreamer.h"
+#include "TextureTable.h"
+#include "TextureResidency.h"
+#include "QuadBenchmark.h"
+#include "CommandBuffer.h"
+#include "Buffer.h"
+#include "VertexArray.h"
+#include "RenderThread.h"
+#include "JobSystem.h"
+#include "SceneGraph.h"
+#include "FrustumCuller.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -11,7 +23,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void render(RenderThread& renderer, JobSystem& jobs, bool benchmark);
 void processInput(GLFWwindow* window);
 
 float scale_number(float x, float oMin, float oMax, float nMin, float nMax);
@@ -20,8 +32,11 @@ float scale_number(float x, float oMin, float oMax, float nMin, float nMax);
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-int main()
+int main(int argc, char** argv)
 {
+	// --benchmark: time per-draw against instanced quads once the textures are loaded, then exit
+	bool benchmark = argc > 1 && strcmp(argv[1], "--benchmark") == 0;
+
 #pragma region // init glwf 
 
 	glfwInit();
@@ -43,19 +58,63 @@ int main()
 		glfwTerminate();
 		return -1;
 	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	//glfwSetWindowMonitor(window, primary, 0, 0, mode->width, mode->height, mode->refreshRate);
 #pragma endregion
+
+	// engine tasks (texture decoding, ...) run on the job system's workers, one per remaining core
+	JobSystem jobs;
+	// the render thread owns the GL context from here on; this thread handles events, input and simulation
+	RenderThread renderer(window, [&jobs, benchmark](RenderThread& thread) { render(thread, jobs, benchmark); });
+
+	// object transforms form a hierarchy; update() recomputes only the nodes that moved and their children.
+	// Node 0 is the quad; a node created as scene.create(0, glm::vec3(0.5f, -0.5f, 0.0f)) would sit offset in
+	// its space and follow it through scene.setRotation(0, glm::angleAxis(angle, glm::vec3(0.0f, 0.0f, 1.0f)))
+	SceneGraph scene;
+	scene.create();
+
+	// main loop: events, input and simulation, then hand the frame to the render thread
+	uint64_t frame = 0;
+	while (!glfwWindowShouldClose(window) && renderer.running())
+	{
+		// glfw: poll IO events (keys pressed/release, mouse moved, etc.)
+		glfwPollEvents();
+		processInput(window);
+
+		FramePacket packet;
+		packet.frame = frame++;
+		packet.time = glfwGetTime();
+		glfwGetFramebufferSize(window, &packet.framebufferWidth, &packet.framebufferHeight);
+		// the render thread keeps the last matrices it got, so they only travel when something moved
+		if (scene.update(&jobs) > 0)
+			packet.transforms = scene.worldMatrices();
+		if (!renderer.submit(std::move(packet)))
+			break;
+	}
+	renderer.stop();
+	jobs.dispose();
+
+	// glfw: terminate, clearing all previously allocated GLFW resources
+	glfwTerminate();
+	return 0;
+}
+
+
+// render thread: owns the GL context, loads resources and draws the frames the main thread submits
+void render(RenderThread& renderer, JobSystem& jobs, bool benchmark)
+{
 #pragma region // init GLAD
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
 	{
 		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
+		return;
 	}
 #pragma endregion
 
-	Shader textureProgram("./BrickTexture.vs", "./BrickTexture.fs");
+	// shaders pick textures by index from the table, so the render loop never rebinds them.
+	// Bindless handles when the driver has them, otherwise 512x512 layers of a texture array
+	TextureTable textureTable(512, 512, 16, MipMode::None, GL_RGBA8, (GLADloadproc)glfwGetProcAddress);
+	Shader textureProgram("./BrickTexture.vs", textureTable.backend() == TextureBackend::Bindless
+		? "./BrickTextureBindless.fs" : "./BrickTextureArray.fs");
 
 	float boxData[] = {
 		// positions	  // colors			// texture coords
@@ -69,97 +128,115 @@ int main()
 		1, 2, 3  // second triangle
 	};
 
-	unsigned int VBO, VAO, EBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(boxData), boxData, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	// color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-	// texture coord attribute
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-	glBindVertexArray(0);
-
-	stbi_set_flip_vertically_on_load(true);
-	unsigned int texture1, texture2;
-	glGenTextures(1, &texture1);
-	glBindTexture(GL_TEXTURE_2D, texture1);
-	// set the texture wrapping/filtering options (on currently bound texture)
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	const char* imagePath1 = "./container.jpg";
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load(imagePath1, &width, &height, &nrChannels, 0);
-	if (data) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else {
-		std::cout << "Failed to load texture1" << std::endl;
-	}
-	stbi_image_free(data);
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	glGenTextures(1, &texture2);
-	glBindTexture(GL_TEXTURE_2D, texture2);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	const char* imagePath2 = "./ketos.jpg";
-	data = stbi_load(imagePath2, &width, &height, &nrChannels, 0);
-	if (data) {
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-	}
-	else {
-		std::cout << "Failed to load texture2" << std::endl;
-	}
-	stbi_image_free(data);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	// half3 position, RGBA8 color, unorm16x2 texcoord: 16 bytes per vertex instead of 32
+	VertexFormat boxFormat;
+	boxFormat.add(0, 3, AttributeEncoding::HalfFloat).add(1, 3, AttributeEncoding::UNorm8).add(2, 2, AttributeEncoding::UNorm16);
+	const size_t boxVertices = sizeof(boxData) / sizeof(float) / boxFormat.sourceFloats();
+	std::vector<unsigned char> boxVertexData(boxVertices * boxFormat.stride());
+	boxFormat.pack(boxData, boxVertices, boxVertexData.data());
+
+	// created through direct state access: nothing is bound until the draw
+	Buffer boxVertexBuffer(boxVertexData.size(), boxVertexData.data(), 0);
+	Buffer boxIndexBuffer(sizeof(indices), indices, 0);
+	VertexArray boxArray;
+	boxArray.setFormat(boxFormat, 0);
+	boxArray.setVertexBuffer(0, boxVertexBuffer.ID, 0, boxFormat.stride());
+	boxArray.setIndexBuffer(boxIndexBuffer.ID);
+	unsigned int VAO = boxArray.ID;
+
+	// textures are decoded as jobs and uploaded through a PBO ring, so loading never blocks rendering;
+	// decoded images are baked into ./texcache so later launches skip JPEG decoding and compression.
+	// The quad is drawn at about native size with GL_LINEAR filtering, so no mip levels are allocated
+	TextureStreamer textureStreamer(jobs, 64 * 1024 * 1024, "./texcache");
+	textureStreamer.setFlipVertically(true);
+	TextureOptions textureOptions;
+	textureOptions.internalFormat = GL_RGBA8;
+	textureOptions.mips = MipMode::None;
+	// BC7 keeps the photos close to the original at a quarter of the memory, BC1 is the fallback at an eighth.
+	// The array backend blits textures of other sizes into its layers, which compressed ones can't be
+	if (textureTable.backend() == TextureBackend::Bindless)
+		textureOptions.compression = BlockCompressor::isSupported(BlockFormat::BC7) ? BlockFormat::BC7 : BlockFormat::BC1;
+	// the streamed textures are owned by the residency manager, which keeps them within 256 MB of VRAM
+	TextureResidency textureResidency(textureStreamer, 256 * 1024 * 1024);
+	// print what the compression costs for one of them, when it is encoded rather than read from the cache
+	textureOptions.reportQuality = true;
+	int textureHandle1 = textureResidency.load("./container.jpg", textureOptions);
+	textureOptions.reportQuality = false;
+	int textureHandle2 = textureResidency.load("./ketos.jpg", textureOptions);
+
+	// table indices of the two textures, assigned once they have finished streaming in
+	bool texturesAdded = false;
+	int textureIndex1 = -1, textureIndex2 = -1;
 
 	textureProgram.use(); // don’t forget to activate the shader first!
-	glUniform1i(glGetUniformLocation(textureProgram.ID, "texture1"), 0); // manually
-	textureProgram.setInt("texture2", 1); // or with shader class
-
-	// vector tranlation
-	//glm::vec4 vec(1.0f, 0.0f, 0.0f, 1.0f);
-	//glm::mat4 trans = glm::mat4(1.0f);
-	//trans = glm::translate(trans, glm::vec3(1.0f, 1.0f, 0.0f));
-	//vec = trans * vec;
-	//std::cout << vec.x << vec.y << vec.z << std::endl;
-
-	glm::mat4 trans = glm::mat4(1.0f);
-	//trans = glm::rotate(trans, glm::radians(90.0f), glm::vec3(0.0, 0.0, 1.0));
-	//trans = glm::scale(trans, glm::vec3(0.5, 0.5, 0.5));
-
-	//glm::mat4 trans = glm::mat4(1.0f);
-	//trans = glm::translate(trans, glm::vec3(0.5f, -0.5f, 0.0f));
-	//trans = glm::rotate(trans, (float)glfwGetTime(),
-	//	glm::vec3(0.0f, 0.0f, 1.0f));
+	glUniform1i(glGetUniformLocation(textureProgram.ID, "textures"), 0); // manually
+	textureProgram.setInt("textureIndex1", 0); // or with shader class
+	textureProgram.setInt("textureIndex2", 0);
+	textureProgram.setFloat("mixFactor", 0.8f);
+	textureProgram.setBool("instanced", false);
+	textureTable.bind(0, 0);
 
 	unsigned int transformLoc = glGetUniformLocation(textureProgram.ID, "transform");
-	glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
-
-
-
-	// render loop
-	while (!glfwWindowShouldClose(window))
+	glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+
+	// draws are recorded with a sort key, sorted by state once per frame and replayed
+	// as one glMultiDrawElementsIndirect per run of equal shader, texture and VAO
+	CommandBuffer commandBuffer;
+	// objects outside the view are dropped before they are recorded. The transforms take the quad straight to
+	// clip space, so the view-projection is the identity
+	FrustumCuller culler;
+	std::vector<unsigned int> visible;
+	// world matrices of the last packet that carried any
+	std::vector<glm::mat4> transforms;
+
+	// render loop: one iteration per packet from the main thread
+	FramePacket packet;
+	int viewportWidth = 0, viewportHeight = 0;
+	while (renderer.next(packet))
 	{
-		// input
-		processInput(window);
+		if (packet.framebufferWidth != viewportWidth || packet.framebufferHeight != viewportHeight)
+		{
+			viewportWidth = packet.framebufferWidth;
+			viewportHeight = packet.framebufferHeight;
+			GLState::viewport(0, 0, viewportWidth, viewportHeight);
+		}
+
+		// upload whatever finished decoding since last frame
+		textureStreamer.update();
+		textureResidency.update();
+		unsigned int texture1 = textureResidency.use(textureHandle1);
+		unsigned int texture2 = textureResidency.use(textureHandle2);
+		if (!texturesAdded && texture1 && texture2)
+		{
+			texturesAdded = true;
+			textureIndex1 = textureTable.add(texture1);
+			textureIndex2 = textureTable.add(texture2);
+			// bindless handles point at these exact textures, so eviction must leave them alone
+			if (textureTable.backend() == TextureBackend::Bindless)
+			{
+				textureResidency.pin(textureHandle1);
+				textureResidency.pin(textureHandle2);
+			}
+			textureProgram.setInt("textureIndex1", textureIndex1);
+			textureProgram.setInt("textureIndex2", textureIndex2);
+			if (benchmark && textureIndex1 >= 0 && textureIndex2 >= 0)
+			{
+				QuadBenchmark::run(textureProgram, VAO, textureIndex1, textureIndex2, 20000, 100,
+					(GLADloadproc)glfwGetProcAddress, &jobs);
+				glfwSetWindowShouldClose(renderer.window, true);
+				break;
+			}
+		}
+
+		// boxes only change with the matrices
+		if (!packet.transforms.empty())
+		{
+			transforms.swap(packet.transforms);
+			while (culler.size() < transforms.size())
+				culler.addSphere(glm::vec3(0.0f), 0.0f);
+			for (size_t i = 0; i < transforms.size(); i++)
+				culler.setBox((unsigned int)i, glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, 0.5f, 0.0f), transforms[i]);
+		}
 
 		// render
 		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
@@ -167,32 +244,42 @@ int main()
 
 
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-		// glfw: swap buffers and poll IO events (keys pressed/release, mouse moved, etc.)
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+		// an unset bindless handle must never be sampled, so wait for both textures
+		if (textureIndex1 >= 0 && textureIndex2 >= 0)
+		{
+			// parallelFor only helps with its own chunks here, so a queued decode can't stall the frame
+			culler.cull(glm::mat4(1.0f), visible, &jobs);
+			for (size_t v = 0; v < visible.size(); v++)
+			{
+				// objects are never removed from the culler; ones past this frame's count are stale
+				if (visible[v] >= transforms.size())
+					continue;
+				QuadInstance quad = { transforms[visible[v]], textureIndex1, textureIndex2, 0.8f, 0.0f };
+				commandBuffer.list(0).draw(textureProgram, VAO, 0, quad);
+			}
+		}
+		commandBuffer.submit();
+		GLState::endFrame();
+
+		// glfw: swap buffers; events are polled by the main thread
+		glfwSwapBuffers(renderer.window);
 	}
 
+	const GLStateCounters& stateCalls = GLState::lastFrame();
+	std::cout << "GL state calls in the last frame: " << stateCalls.issued << " issued, " << stateCalls.elided
+		<< " elided (" << stateCalls.elidedPrograms << " programs, " << stateCalls.elidedVertexArrays << " vertex arrays, "
+		<< stateCalls.elidedTextures << " textures, " << stateCalls.elidedFixedFunction << " blend/depth/viewport)"
+		<< std::endl;
+
 	// optional: de-allocate all resources once they-ve outlived their purpose:
 	textureProgram.dispose();
-
-	// glfw: terminate, clearing all previously allocated GLFW resources
-	glfwTerminate();
-	return 0;
-}
-
-
-// glfw: whenever the window size changed (by OS or user resize) this callback function executes
-void framebuffer_size_callback(GLFWwindow* window, int width, int height)
-{
-	glViewport(0, 0, width, height);
+	commandBuffer.dispose();
+	textureTable.dispose();
+	textureResidency.dispose();
+	textureStreamer.dispose();
+	boxArray.dispose();
+	boxVertexBuffer.dispose();
+	boxIndexBuffer.dispose();
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile), so file
+// contents can be hashed or copied into upload buffers without an extra read copy.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// map the file, replacing any previous mapping; returns false if it can't be opened
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const { return data != NULL; }
+
+	const unsigned char* data;
+	size_t size;
+
+private:
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#else
+	int file;
+#endif
+};
@@ -0,0 +1,276 @@
+#include "MipGenerator.h"
+#include "Texture.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX__)
+#define MIP_AVX
+#include <immintrin.h>
+#endif
+
+// Kaiser window parameters: lobes on each side of the center and shape (higher is smoother)
+static const float KAISER_RADIUS = 3.0f;
+static const float KAISER_ALPHA = 4.0f;
+// resolution of the linear -> sRGB encode table
+static const int SRGB_TABLE_SIZE = 4096;
+
+struct ConversionTables
+{
+	float srgbToLinear[256];
+	float unormToFloat[256];
+	unsigned char linearToSrgb[SRGB_TABLE_SIZE + 1];
+
+	ConversionTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			srgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			unormToFloat[i] = c;
+		}
+		for (int i = 0; i <= SRGB_TABLE_SIZE; i++)
+		{
+			float l = (float)i / SRGB_TABLE_SIZE;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+			linearToSrgb[i] = (unsigned char)(c * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const ConversionTables& tables()
+{
+	static const ConversionTables instance;
+	return instance;
+}
+
+// zeroth order modified Bessel function of the first kind, for the Kaiser window
+static double besselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++)
+	{
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+static float kaiser(float t)
+{
+	const double pi = 3.14159265358979323846;
+	double x = t / KAISER_RADIUS;
+	if (x <= -1.0 || x >= 1.0)
+		return 0.0f;
+	double window = besselI0(KAISER_ALPHA * sqrt(1.0 - x * x)) / besselI0(KAISER_ALPHA);
+	double sinc = t == 0.0f ? 1.0 : sin(pi * t) / (pi * t);
+	return (float)(window * sinc);
+}
+
+void MipGenerator::build(const unsigned char* src, int width, int height, int levels, unsigned char* dst,
+	MipFilter filter, bool srgb)
+{
+	size_t baseSize = (size_t)width * height * 4;
+	memcpy(dst, src, baseSize);
+	if (levels < 2)
+		return;
+
+	// work in linear float and always filter from the previous float level, so 8-bit rounding doesn't accumulate
+	std::vector<float> current(baseSize), next, scratch;
+	decode(src, (size_t)width * height, current.data(), srgb);
+
+	unsigned char* out = dst + baseSize;
+	int w = width, h = height;
+	for (int level = 1; level < levels; level++)
+	{
+		int nw = Texture::levelDimension(width, level);
+		int nh = Texture::levelDimension(height, level);
+		next.resize((size_t)nw * nh * 4);
+		downsample(current.data(), w, h, next.data(), nw, nh, filter, scratch);
+		encode(next.data(), (size_t)nw * nh, out, srgb);
+
+		out += (size_t)nw * nh * 4;
+		current.swap(next);
+		w = nw;
+		h = nh;
+	}
+}
+
+std::vector<MipGenerator::Taps> MipGenerator::computeTaps(int srcSize, int dstSize, MipFilter filter)
+{
+	std::vector<Taps> taps(dstSize);
+	float scale = (float)srcSize / dstSize;
+
+	for (int i = 0; i < dstSize; i++)
+	{
+		// output pixel i covers [i * scale, (i + 1) * scale) in source pixels
+		float center = (i + 0.5f) * scale;
+		float support = filter == MipFilter::Box ? scale * 0.5f : KAISER_RADIUS * scale;
+		int first = (int)floorf(center - support);
+		int last = (int)ceilf(center + support) - 1;
+
+		Taps& t = taps[i];
+		t.weights.assign(last - first + 1, 0.0f);
+		float total = 0.0f;
+		for (int s = first; s <= last; s++)
+		{
+			float w;
+			if (filter == MipFilter::Box)
+			{
+				// overlap of source pixel [s, s + 1) with the output footprint
+				float lo = std::fmax((float)s, center - support);
+				float hi = std::fmin((float)s + 1.0f, center + support);
+				w = hi > lo ? hi - lo : 0.0f;
+			}
+			else
+			{
+				// kernel is measured in output texels so its zeros fall on neighbouring output texels
+				w = kaiser((s + 0.5f - center) / scale);
+			}
+			// clamp to edge: fold taps outside the image onto the border texel
+			int clamped = s < 0 ? 0 : (s >= srcSize ? srcSize - 1 : s);
+			t.weights[clamped - first] += w;
+			total += w;
+		}
+		for (size_t k = 0; k < t.weights.size(); k++)
+			t.weights[k] /= total;
+
+		// drop zero weights at either end so the inner loops stay short
+		size_t begin = 0, end = t.weights.size();
+		while (begin < end && t.weights[begin] == 0.0f)
+			begin++;
+		while (end > begin && t.weights[end - 1] == 0.0f)
+			end--;
+		t.first = first + (int)begin;
+		t.weights = std::vector<float>(t.weights.begin() + begin, t.weights.begin() + end);
+	}
+	return taps;
+}
+
+void MipGenerator::downsample(const float* src, int srcWidth, int srcHeight, float* dst, int dstWidth, int dstHeight,
+	MipFilter filter, std::vector<float>& scratch)
+{
+	std::vector<Taps> columns = computeTaps(srcWidth, dstWidth, filter);
+	std::vector<Taps> rows = computeTaps(srcHeight, dstHeight, filter);
+
+	// horizontal pass: srcHeight rows of dstWidth pixels, one RGBA pixel per SSE register
+	scratch.resize((size_t)dstWidth * srcHeight * 4);
+	for (int y = 0; y < srcHeight; y++)
+	{
+		const float* row = src + (size_t)y * srcWidth * 4;
+		float* out = scratch.data() + (size_t)y * dstWidth * 4;
+		for (int x = 0; x < dstWidth; x++)
+		{
+			const Taps& t = columns[x];
+			const float* p = row + (size_t)t.first * 4;
+#ifdef MIP_SSE2
+			__m128 sum = _mm_setzero_ps();
+			for (size_t k = 0; k < t.weights.size(); k++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(p + k * 4), _mm_set1_ps(t.weights[k])));
+			_mm_storeu_ps(out + x * 4, sum);
+#else
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (size_t k = 0; k < t.weights.size(); k++)
+				for (int c = 0; c < 4; c++)
+					sum[c] += p[k * 4 + c] * t.weights[k];
+			memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+		}
+	}
+
+	// vertical pass: weighted sum of whole rows, 8 floats at a time with AVX
+	size_t rowFloats = (size_t)dstWidth * 4;
+	for (int y = 0; y < dstHeight; y++)
+	{
+		const Taps& t = rows[y];
+		float* out = dst + (size_t)y * rowFloats;
+		size_t i = 0;
+#ifdef MIP_AVX
+		for (; i + 8 <= rowFloats; i += 8)
+		{
+			__m256 sum = _mm256_setzero_ps();
+			for (size_t k = 0; k < t.weights.size(); k++)
+			{
+				const float* in = scratch.data() + (size_t)(t.first + k) * rowFloats + i;
+				sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(in), _mm256_set1_ps(t.weights[k])));
+			}
+			_mm256_storeu_ps(out + i, sum);
+		}
+#endif
+#ifdef MIP_SSE2
+		for (; i + 4 <= rowFloats; i += 4)
+		{
+			__m128 sum = _mm_setzero_ps();
+			for (size_t k = 0; k < t.weights.size(); k++)
+			{
+				const float* in = scratch.data() + (size_t)(t.first + k) * rowFloats + i;
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(in), _mm_set1_ps(t.weights[k])));
+			}
+			_mm_storeu_ps(out + i, sum);
+		}
+#endif
+		for (; i < rowFloats; i++)
+		{
+			float sum = 0.0f;
+			for (size_t k = 0; k < t.weights.size(); k++)
+				sum += scratch[(size_t)(t.first + k) * rowFloats + i] * t.weights[k];
+			out[i] = sum;
+		}
+	}
+}
+
+void MipGenerator::decode(const unsigned char* src, size_t pixels, float* dst, bool srgb)
+{
+	const ConversionTables& lut = tables();
+	const float* color = srgb ? lut.srgbToLinear : lut.unormToFloat;
+	for (size_t i = 0; i < pixels; i++)
+	{
+		dst[i * 4 + 0] = color[src[i * 4 + 0]];
+		dst[i * 4 + 1] = color[src[i * 4 + 1]];
+		dst[i * 4 + 2] = color[src[i * 4 + 2]];
+		// alpha is never gamma encoded
+		dst[i * 4 + 3] = lut.unormToFloat[src[i * 4 + 3]];
+	}
+}
+
+void MipGenerator::encode(const float* src, size_t pixels, unsigned char* dst, bool srgb)
+{
+	const ConversionTables& lut = tables();
+	size_t i = 0;
+#ifdef MIP_SSE2
+	if (!srgb)
+	{
+		// 4 pixels per iteration: clamp, scale, round and pack to bytes
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+		for (; i + 4 <= pixels; i += 4)
+		{
+			__m128i v[4];
+			for (int p = 0; p < 4; p++)
+			{
+				__m128 c = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + (i + p) * 4), zero), one);
+				v[p] = _mm_cvtps_epi32(_mm_mul_ps(c, scale));
+			}
+			__m128i packed = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+			_mm_storeu_si128((__m128i*)(dst + i * 4), packed);
+		}
+	}
+#endif
+	for (; i < pixels; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			float v = src[i * 4 + c];
+			v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+			if (srgb && c < 3)
+				dst[i * 4 + c] = lut.linearToSrgb[(int)(v * SRGB_TABLE_SIZE + 0.5f)];
+			else
+				dst[i * 4 + c] = (unsigned char)(v * 255.0f + 0.5f);
+		}
+	}
+}
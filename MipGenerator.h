@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// downsampling kernel used for each mip level
+enum class MipFilter
+{
+	Box,    // area average, cheapest
+	Kaiser  // Kaiser-windowed sinc, sharper levels with less aliasing
+};
+
+// Builds a full RGBA8 mip chain on the CPU so it can be produced on decode
+// threads and uploaded in one go. Levels are stored back to back in one
+// buffer (the layout Texture::uploadChain expects). Filtering runs in linear
+// float: sRGB data is decoded before averaging and re-encoded afterwards, so
+// dark and bright texels are weighted by light rather than by code value.
+// Any size is handled, odd dimensions use fractional tap weights.
+class MipGenerator
+{
+public:
+	// src is level 0 (width*height*4 bytes); dst receives Texture::chainSize(width, height, levels) bytes.
+	// dst is only written, never read, so it may point into write-combined mapped memory.
+	static void build(const unsigned char* src, int width, int height, int levels, unsigned char* dst,
+		MipFilter filter, bool srgb);
+
+private:
+	// source pixel span and normalized weights feeding one output pixel along one axis
+	struct Taps
+	{
+		int first;
+		std::vector<float> weights;
+	};
+
+	static std::vector<Taps> computeTaps(int srcSize, int dstSize, MipFilter filter);
+	static void downsample(const float* src, int srcWidth, int srcHeight, float* dst, int dstWidth, int dstHeight,
+		MipFilter filter, std::vector<float>& scratch);
+	static void decode(const unsigned char* src, size_t pixels, float* dst, bool srgb);
+	static void encode(const float* src, size_t pixels, unsigned char* dst, bool srgb);
+};
@@ -0,0 +1,200 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+	: columns(width > 0 ? width : 1), rows(height > 0 ? height : 1)
+{
+	if (width <= 0 || height <= 0)
+		std::cout << "ERROR::OCCLUSION_BUFFER::BAD_SIZE " << width << "x" << height << std::endl;
+	depths.assign((size_t)columns * rows, 1.0f);
+}
+
+void OcclusionBuffer::clear()
+{
+	std::fill(depths.begin(), depths.end(), 1.0f);
+}
+
+bool OcclusionBuffer::project(const glm::mat4& m, const glm::vec3& p, ScreenPoint& out) const
+{
+	float x = m[0][0] * p.x + m[1][0] * p.y + m[2][0] * p.z + m[3][0];
+	float y = m[0][1] * p.x + m[1][1] * p.y + m[2][1] * p.z + m[3][1];
+	float z = m[0][2] * p.x + m[1][2] * p.y + m[2][2] * p.z + m[3][2];
+	float w = m[0][3] * p.x + m[1][3] * p.y + m[2][3] * p.z + m[3][3];
+	if (w <= 1e-6f || z < -w)
+		return false;
+	float inverse = 1.0f / w;
+	out.x = (x * inverse * 0.5f + 0.5f) * columns;
+	out.y = (y * inverse * 0.5f + 0.5f) * rows;
+	out.z = z * inverse * 0.5f + 0.5f;
+	return true;
+}
+
+int OcclusionBuffer::convexHull(ScreenPoint* points, int count, ScreenPoint* hull)
+{
+	std::sort(points, points + count, [](const ScreenPoint& p, const ScreenPoint& q)
+	{
+		return p.x < q.x || (p.x == q.x && p.y < q.y);
+	});
+	auto turn = [](const ScreenPoint& o, const ScreenPoint& p, const ScreenPoint& q)
+	{
+		return (p.x - o.x) * (q.y - o.y) - (p.y - o.y) * (q.x - o.x);
+	};
+	int size = 0;
+	// lower chain left to right, then upper chain right to left
+	for (int i = 0; i < count; i++)
+	{
+		while (size >= 2 && turn(hull[size - 2], hull[size - 1], points[i]) <= 0.0f)
+			size--;
+		hull[size++] = points[i];
+	}
+	for (int i = count - 2, lower = size + 1; i >= 0; i--)
+	{
+		while (size >= lower && turn(hull[size - 2], hull[size - 1], points[i]) <= 0.0f)
+			size--;
+		hull[size++] = points[i];
+	}
+	return size - 1;  // the last point repeats the first
+}
+
+void OcclusionBuffer::addOccluder(const glm::mat4& viewProjection, const glm::vec3& min, const glm::vec3& max)
+{
+	ScreenPoint corners[8];
+	bool inFront[8];
+	bool allInFront = true;
+	float z = 0.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+		inFront[i] = project(viewProjection, corner, corners[i]);
+		allInFront = allInFront && inFront[i];
+		if (inFront[i])
+			z = std::max(z, corners[i].z);
+	}
+
+	if (allInFront)
+	{
+		// the box covers its whole silhouette, no nearer than its farthest corner
+		ScreenPoint hull[9];
+		int size = convexHull(corners, 8, hull);
+		rasterize(hull, size, z);
+		return;
+	}
+
+	// the box reaches the camera: rasterize the faces entirely in front of the near plane on their own
+	static const int faces[6][4] = {
+		{ 0, 2, 6, 4 }, { 1, 3, 7, 5 },  // -x, +x
+		{ 0, 1, 5, 4 }, { 2, 3, 7, 6 },  // -y, +y
+		{ 0, 1, 3, 2 }, { 4, 5, 7, 6 }   // -z, +z
+	};
+	for (int f = 0; f < 6; f++)
+	{
+		const int* face = faces[f];
+		if (!inFront[face[0]] || !inFront[face[1]] || !inFront[face[2]] || !inFront[face[3]])
+			continue;
+		ScreenPoint quad[4] = { corners[face[0]], corners[face[1]], corners[face[2]], corners[face[3]] };
+		float farthest = std::max(std::max(quad[0].z, quad[1].z), std::max(quad[2].z, quad[3].z));
+		rasterize(quad, 4, farthest);
+	}
+}
+
+void OcclusionBuffer::addTriangle(const glm::mat4& viewProjection, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+	// clipping would only ever shrink the occluder, so a triangle crossing the near plane is dropped instead
+	ScreenPoint points[3];
+	if (!project(viewProjection, a, points[0]) || !project(viewProjection, b, points[1]) || !project(viewProjection, c, points[2]))
+		return;
+	rasterize(points, 3, std::max(points[0].z, std::max(points[1].z, points[2].z)));
+}
+
+void OcclusionBuffer::rasterize(const ScreenPoint* points, int count, float z)
+{
+	float area = 0.0f;
+	float left = points[0].x, right = points[0].x, bottom = points[0].y, top = points[0].y;
+	for (int i = 0; i < count; i++)
+	{
+		const ScreenPoint& p = points[i];
+		const ScreenPoint& q = points[(i + 1) % count];
+		area += p.x * q.y - q.x * p.y;
+		left = std::min(left, p.x);
+		right = std::max(right, p.x);
+		bottom = std::min(bottom, p.y);
+		top = std::max(top, p.y);
+	}
+	if (area == 0.0f)
+		return;
+	// either winding: flip the edge functions of clockwise polygons
+	float sign = area > 0.0f ? 1.0f : -1.0f;
+
+	// edge i is a * px + b * py + c >= 0 inside; a whole pixel is inside when its center clears
+	// the edge by half its extent along the edge normal
+	float a[8], b[8], c[8], margin[8];
+	for (int i = 0; i < count; i++)
+	{
+		const ScreenPoint& p = points[i];
+		const ScreenPoint& q = points[(i + 1) % count];
+		a[i] = -(q.y - p.y) * sign;
+		b[i] = (q.x - p.x) * sign;
+		c[i] = -(a[i] * p.x + b[i] * p.y);
+		margin[i] = 0.5f * (std::fabs(a[i]) + std::fabs(b[i]));
+	}
+
+	// only pixels inside the bounding rectangle can be covered completely
+	int x0 = std::max(0, (int)std::ceil(left));
+	int x1 = std::min(columns - 1, (int)std::floor(right) - 1);
+	int y0 = std::max(0, (int)std::ceil(bottom));
+	int y1 = std::min(rows - 1, (int)std::floor(top) - 1);
+	for (int y = y0; y <= y1; y++)
+	{
+		float py = y + 0.5f;
+		float* row = &depths[(size_t)y * columns];
+		for (int x = x0; x <= x1; x++)
+		{
+			if (z >= row[x])
+				continue;
+			float px = x + 0.5f;
+			bool covered = true;
+			for (int i = 0; i < count && covered; i++)
+				covered = a[i] * px + b[i] * py + c[i] >= margin[i];
+			if (covered)
+				row[x] = z;
+		}
+	}
+}
+
+bool OcclusionBuffer::isVisible(const glm::mat4& viewProjection, const glm::vec3& min, const glm::vec3& max) const
+{
+	float left = 1e30f, right = -1e30f, bottom = 1e30f, top = -1e30f, nearest = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		glm::vec3 corner(i & 1 ? max.x : min.x, i & 2 ? max.y : min.y, i & 4 ? max.z : min.z);
+		ScreenPoint p;
+		// a box reaching the camera can't be proven hidden
+		if (!project(viewProjection, corner, p))
+			return true;
+		left = std::min(left, p.x);
+		right = std::max(right, p.x);
+		bottom = std::min(bottom, p.y);
+		top = std::max(top, p.y);
+		nearest = std::min(nearest, p.z);
+	}
+
+	// every pixel the rectangle touches, not just those whose center it covers
+	int x0 = std::max(0, (int)std::floor(left));
+	int x1 = std::min(columns - 1, (int)std::ceil(right) - 1);
+	int y0 = std::max(0, (int)std::floor(bottom));
+	int y1 = std::min(rows - 1, (int)std::ceil(top) - 1);
+	if (x0 > x1 || y0 > y1)
+		return true;  // off screen or smaller than a pixel: left to the frustum test
+	for (int y = y0; y <= y1; y++)
+	{
+		const float* row = &depths[(size_t)y * columns];
+		for (int x = x0; x <= x1; x++)
+		{
+			if (row[x] >= nearest)
+				return true;
+		}
+	}
+	return false;
+}
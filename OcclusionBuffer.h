@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Low-resolution software depth buffer for occlusion culling on the CPU.
+// Large objects (walls, terrain blocks, the quads of a tiled floor) are
+// rasterized into it as occluders, then other objects' bounding boxes are
+// tested against it: a box is hidden when every pixel its screen rectangle
+// touches already holds something nearer than the box's nearest point.
+//
+// Occluders write their farthest depth rather than an interpolated one,
+// only into pixels they cover completely, and parts in front of the near
+// plane are skipped, so errors only ever keep an object visible. An occluder
+// box is rasterized as its whole screen silhouette; separate triangles don't
+// merge, so pixels on an edge two triangles share stay open.
+class OcclusionBuffer
+{
+public:
+	OcclusionBuffer(int width = 256, int height = 128);
+
+	// reset every pixel to the far plane; call once per frame before adding occluders
+	void clear();
+	// rasterize the world space box [min, max] seen through viewProjection
+	void addOccluder(const glm::mat4& viewProjection, const glm::vec3& min, const glm::vec3& max);
+	// rasterize one world space triangle
+	void addTriangle(const glm::mat4& viewProjection, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	// false when the world space box [min, max] is entirely behind occluders
+	bool isVisible(const glm::mat4& viewProjection, const glm::vec3& min, const glm::vec3& max) const;
+
+	int width() const { return columns; }
+	int height() const { return rows; }
+	// depth in [0, 1] (0 near), row 0 at the bottom like GL window coordinates
+	float depth(int x, int y) const { return depths[(size_t)y * columns + x]; }
+
+private:
+	struct ScreenPoint
+	{
+		float x, y, z;  // pixels, and depth in [0, 1]
+	};
+
+	int columns, rows;
+	std::vector<float> depths;
+
+	// false when the point is on or behind the near plane
+	bool project(const glm::mat4& viewProjection, const glm::vec3& point, ScreenPoint& out) const;
+	// convex hull of count points (monotone chain, sorts points), counterclockwise into hull (count + 1 slots); returns its size
+	static int convexHull(ScreenPoint* points, int count, ScreenPoint* hull);
+	// write z into the pixels fully inside the convex polygon (either winding, at most 8 points)
+	void rasterize(const ScreenPoint* points, int count, float z);
+};
@@ -0,0 +1,195 @@
+#include "QuadBenchmark.h"
+
+void QuadBenchmark::run(Shader& shader, unsigned int vao, int texture1, int texture2, int quadCount, int frames,
+	GLADloadproc loader, JobSystem* jobs)
+{
+	// small quads scattered over the viewport, each with its own rotation and blend
+	std::vector<QuadInstance> quads(quadCount);
+	srand(1);
+	for (int i = 0; i < quadCount; i++)
+	{
+		float x = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+		float y = rand() / (float)RAND_MAX * 2.0f - 1.0f;
+		glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0.0f));
+		transform = glm::rotate(transform, rand() / (float)RAND_MAX * 6.2831853f, glm::vec3(0.0f, 0.0f, 1.0f));
+		quads[i].transform = glm::scale(transform, glm::vec3(0.02f, 0.02f, 1.0f));
+		quads[i].texture1 = texture1;
+		quads[i].texture2 = texture2;
+		quads[i].mixFactor = rand() / (float)RAND_MAX;
+		quads[i].padding = 0.0f;
+	}
+
+	std::cout << "BENCHMARK::QUADS " << quadCount << " quads, " << frames << " frames" << std::endl;
+	report("per-draw ", perDraw(shader, vao, quads, frames), quads.size(), quads.size());
+	report("instanced", instanced(shader, vao, quads, frames), quads.size(), 1);
+	// one glMultiDrawElementsIndirect call carries all the commands
+	report("multidraw", multiDraw(shader, vao, quads, frames), quads.size(), 1);
+	gpuCulled(shader, vao, quads, frames, loader, jobs);
+}
+
+double QuadBenchmark::perDraw(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames)
+{
+	shader.use();
+	shader.setBool("instanced", false);
+	// look the uniforms up once, the comparison is about draw submission and not glGetUniformLocation
+	int transformLoc = glGetUniformLocation(shader.ID, "transform");
+	int texture1Loc = glGetUniformLocation(shader.ID, "textureIndex1");
+	int texture2Loc = glGetUniformLocation(shader.ID, "textureIndex2");
+	int mixLoc = glGetUniformLocation(shader.ID, "mixFactor");
+	GLState::bindVertexArray(vao);
+
+	std::chrono::steady_clock::time_point start;
+	// frame 0 warms up and is not timed
+	for (int frame = 0; frame <= frames; frame++)
+	{
+		if (frame == 1)
+			start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT);
+		for (size_t i = 0; i < quads.size(); i++)
+		{
+			glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(quads[i].transform));
+			glUniform1i(texture1Loc, quads[i].texture1);
+			glUniform1i(texture2Loc, quads[i].texture2);
+			glUniform1f(mixLoc, quads[i].mixFactor);
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+		}
+		glFinish();
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+double QuadBenchmark::instanced(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames)
+{
+	InstancedQuads batch(quads.size());
+	std::chrono::steady_clock::time_point start;
+	for (int frame = 0; frame <= frames; frame++)
+	{
+		if (frame == 1)
+			start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT);
+		// rebuilt every frame like a real scene would, so the upload is part of the cost
+		batch.clear();
+		for (size_t i = 0; i < quads.size(); i++)
+			batch.add(quads[i]);
+		batch.draw(shader, vao, 6);
+		glFinish();
+	}
+	double frameTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / frames;
+	batch.dispose();
+	return frameTime;
+}
+
+double QuadBenchmark::multiDraw(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames)
+{
+	RenderQueue queue(quads.size());
+	std::chrono::steady_clock::time_point start;
+	for (int frame = 0; frame <= frames; frame++)
+	{
+		if (frame == 1)
+			start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT);
+		for (size_t i = 0; i < quads.size(); i++)
+			queue.submit(shader, vao, quads[i]);
+		queue.flush();
+		glFinish();
+	}
+	double frameTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / frames;
+	queue.dispose();
+	return frameTime;
+}
+
+double QuadBenchmark::gpuCulled(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames,
+	GLADloadproc loader, JobSystem* jobs)
+{
+	static const glm::vec3 QUAD_MIN(-0.5f, -0.5f, 0.0f), QUAD_MAX(0.5f, 0.5f, 0.0f);
+	static const glm::vec3 Z_AXIS(0.0f, 0.0f, 1.0f);
+	// the field spread over twice the viewport in x and y, so about a quarter of it survives culling
+	TransformStore store(quads.size());
+	std::vector<float> angles(quads.size());
+	GpuCuller culler(quads.size(), loader);
+	srand(2);
+	for (size_t i = 0; i < quads.size(); i++)
+	{
+		angles[i] = rand() / (float)RAND_MAX * 6.2831853f;
+		glm::vec3 position(quads[i].transform[3][0] * 2.0f, quads[i].transform[3][1] * 2.0f, 0.0f);
+		store.create(position, glm::angleAxis(angles[i], Z_AXIS), glm::vec3(0.02f, 0.02f, 1.0f));
+		glm::vec3 min, max;
+		FrustumCuller::transformBox(QUAD_MIN, QUAD_MAX, store.compose((unsigned int)i), min, max);
+		culler.add(min, max);
+	}
+	// textures and blends come from quads; the transforms are written in place through the mapping,
+	// which stays valid for the whole pass and needs no flush
+	const GLbitfield mapping = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	Buffer instances(quads.size() * sizeof(QuadInstance), quads.data(), mapping);
+	unsigned char* records = (unsigned char*)instances.map(0, instances.size, mapping);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, InstancedQuads::INSTANCE_BINDING, instances.ID);
+
+	std::chrono::steady_clock::time_point start;
+	size_t written = 0;
+	for (int frame = 0; frame <= frames; frame++)
+	{
+		if (frame == 1)
+		{
+			start = std::chrono::steady_clock::now();
+			written = 0;
+		}
+		// a contiguous sixteenth, so update() rewrites whole groups of four rather than a quad per group
+		size_t slice = (quads.size() + 15) / 16;
+		size_t first = frame > 0 ? (frame % 16) * slice : quads.size();
+		for (size_t i = first; i < std::min(first + slice, quads.size()); i++)
+		{
+			angles[i] += 0.1f;
+			store.setRotation((unsigned int)i, glm::angleAxis(angles[i], Z_AXIS));
+			glm::vec3 min, max;
+			FrustumCuller::transformBox(QUAD_MIN, QUAD_MAX, store.compose((unsigned int)i), min, max);
+			culler.setBounds((unsigned int)i, min, max);
+		}
+		// one buffer is enough because the previous frame's glFinish means the GPU is done reading it, and it
+		// keeps the matrices update() skips. A renderer with frames in flight would cycle through a region per
+		// frame and markAllDirty() when it switches, since a region holds the matrices of frames ago
+		written += store.update(records + offsetof(QuadInstance, transform), sizeof(QuadInstance), jobs);
+		glClear(GL_COLOR_BUFFER_BIT);
+		// the transforms are clip space already
+		culler.cull(glm::mat4(1.0f));
+		culler.draw(shader, vao);
+		glFinish();
+	}
+	double frameTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / frames;
+
+	// the reference sees the quads where the last frame drew them
+	FrustumCuller reference(quads.size());
+	for (size_t i = 0; i < quads.size(); i++)
+	{
+		glm::vec3 min, max;
+		FrustumCuller::transformBox(QUAD_MIN, QUAD_MAX, store.compose((unsigned int)i), min, max);
+		reference.addBox(min, max);
+	}
+	std::vector<unsigned int> visible;
+	reference.cull(glm::mat4(1.0f), visible);
+	GLuint gpuVisible = culler.visibleCount();
+	std::cout << "BENCHMARK::gpu-cull " << gpuVisible << " of " << quads.size() << " visible ("
+		<< visible.size() << " on the CPU), " << (culler.drawsWithCount() ? "glMultiDrawElementsIndirectCount"
+		: "zero-filled glMultiDrawElementsIndirect") << ", " << written / frames << " matrices written per frame"
+		<< std::endl;
+	// the same objects, not just as many: each command's baseInstance is its object's index
+	std::vector<DrawElementsIndirectCommand> commands;
+	culler.readCommands(commands);
+	std::vector<unsigned int> drawn;
+	for (size_t i = 0; i < commands.size(); i++)
+		drawn.push_back(commands[i].baseInstance);
+	std::sort(drawn.begin(), drawn.end());
+	if (drawn != visible)
+		std::cout << "ERROR::BENCHMARK::GPU_CULL_MISMATCH" << std::endl;
+	report("gpu-cull ", frameTime, gpuVisible, 1);
+
+	culler.dispose();
+	instances.unmap();
+	instances.dispose();
+	return frameTime;
+}
+
+void QuadBenchmark::report(const char* name, double frameTime, size_t quads, size_t draws)
+{
+	std::cout << "BENCHMARK::" << name << " " << frameTime * 1000.0 << " ms/frame, "
+		<< (size_t)(quads / frameTime) << " quads/s, " << (size_t)(draws / frameTime) << " draws/s" << std::endl;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Shader.h"
+#include "InstancedQuads.h"
+#include "RenderQueue.h"
+#include "Buffer.h"
+#include "GpuCuller.h"
+#include "TransformStore.h"
+#include "JobSystem.h"
+
+// Draws the same field of textured quads with one glDrawElements per quad,
+// with a single instanced draw and through a RenderQueue multi-draw, and
+// prints quads and draw calls per second of each. Every path ends its frames
+// with glFinish so GPU time is included. A last pass spreads the field past
+// the viewport and draws it through GpuCuller while a sixteenth of the quads
+// turn each frame: a TransformStore writes their matrices straight into the
+// persistently mapped QuadInstance buffer the draws read, and the GPU's
+// visible set is checked against FrustumCuller on the CPU at the end.
+class QuadBenchmark
+{
+public:
+	// shader is the BrickTexture.vs program, vao the quad; textures are TextureTable indices
+	// loader lets GpuCuller use glMultiDrawElementsIndirectCount, jobs spreads the transform updates
+	static void run(Shader& shader, unsigned int vao, int texture1, int texture2, int quadCount = 20000, int frames = 100,
+		GLADloadproc loader = NULL, JobSystem* jobs = NULL);
+
+private:
+	// seconds per frame of each path
+	static double perDraw(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames);
+	static double instanced(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames);
+	static double multiDraw(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames);
+	static double gpuCulled(Shader& shader, unsigned int vao, const std::vector<QuadInstance>& quads, int frames,
+		GLADloadproc loader, JobSystem* jobs);
+	static void report(const char* name, double frameTime, size_t quads, size_t draws);
+};
@@ -0,0 +1,214 @@
+#include "RectPacker.h"
+
+#include <climits>
+
+RectPacker::RectPacker(int width, int height, PackHeuristic heuristic)
+	: binWidth(width), binHeight(height), heuristic(heuristic), usedArea(0)
+{
+	reset();
+}
+
+void RectPacker::reset()
+{
+	usedArea = 0;
+	skyline.clear();
+	freeRects.clear();
+	SkylineNode ground = { 0, 0, binWidth };
+	skyline.push_back(ground);
+	Rect all = { 0, 0, binWidth, binHeight };
+	freeRects.push_back(all);
+}
+
+bool RectPacker::insert(int width, int height, Rect& placed)
+{
+	if (width <= 0 || height <= 0 || width > binWidth || height > binHeight)
+		return false;
+
+	bool found = heuristic == PackHeuristic::Skyline ? insertSkyline(width, height, placed)
+		: insertMaxRects(width, height, placed);
+	if (found)
+		usedArea += (long long)width * height;
+	return found;
+}
+
+float RectPacker::occupancy() const
+{
+	return (float)((double)usedArea / ((double)binWidth * binHeight));
+}
+
+bool RectPacker::insertSkyline(int width, int height, Rect& placed)
+{
+	// bottom-left: lowest resting point wins, ties go to the narrowest node so wide gaps stay open
+	int bestY = INT_MAX, bestWidth = INT_MAX;
+	size_t bestIndex = 0;
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		int y = skylineFit(i, width, height);
+		if (y < 0)
+			continue;
+		if (y + height < bestY || (y + height == bestY && skyline[i].width < bestWidth))
+		{
+			bestY = y + height;
+			bestWidth = skyline[i].width;
+			bestIndex = i;
+		}
+	}
+	if (bestY == INT_MAX)
+		return false;
+
+	placed.x = skyline[bestIndex].x;
+	placed.y = bestY - height;
+	placed.width = width;
+	placed.height = height;
+	addSkylineLevel(bestIndex, placed);
+	return true;
+}
+
+int RectPacker::skylineFit(size_t index, int width, int height) const
+{
+	int x = skyline[index].x;
+	if (x + width > binWidth)
+		return -1;
+
+	// rest on the highest node the rectangle spans
+	int y = 0;
+	int remaining = width;
+	for (size_t i = index; remaining > 0; i++)
+	{
+		if (skyline[i].y > y)
+			y = skyline[i].y;
+		if (y + height > binHeight)
+			return -1;
+		remaining -= skyline[i].width;
+	}
+	return y;
+}
+
+void RectPacker::addSkylineLevel(size_t index, const Rect& placed)
+{
+	SkylineNode node = { placed.x, placed.y + placed.height, placed.width };
+	skyline.insert(skyline.begin() + index, node);
+
+	// trim or remove the nodes now underneath the new one
+	for (size_t i = index + 1; i < skyline.size();)
+	{
+		int shadowEnd = skyline[i - 1].x + skyline[i - 1].width;
+		if (skyline[i].x >= shadowEnd)
+			break;
+		int shrink = shadowEnd - skyline[i].x;
+		skyline[i].x += shrink;
+		skyline[i].width -= shrink;
+		if (skyline[i].width > 0)
+			break;
+		skyline.erase(skyline.begin() + i);
+	}
+
+	// merge neighbours at the same height
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+bool RectPacker::insertMaxRects(int width, int height, Rect& placed)
+{
+	// best short side fit: the free rectangle leaving the smallest leftover strip
+	int bestShort = INT_MAX, bestLong = INT_MAX;
+	for (const Rect& free : freeRects)
+	{
+		if (free.width < width || free.height < height)
+			continue;
+		int leftoverX = free.width - width, leftoverY = free.height - height;
+		int shortSide = leftoverX < leftoverY ? leftoverX : leftoverY;
+		int longSide = leftoverX < leftoverY ? leftoverY : leftoverX;
+		if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong))
+		{
+			bestShort = shortSide;
+			bestLong = longSide;
+			placed.x = free.x;
+			placed.y = free.y;
+		}
+	}
+	if (bestShort == INT_MAX)
+		return false;
+
+	placed.width = width;
+	placed.height = height;
+	splitFreeRects(placed);
+	pruneFreeRects();
+	return true;
+}
+
+void RectPacker::splitFreeRects(const Rect& placed)
+{
+	size_t count = freeRects.size();
+	for (size_t i = 0; i < count;)
+	{
+		Rect free = freeRects[i];
+		if (placed.x >= free.x + free.width || placed.x + placed.width <= free.x ||
+			placed.y >= free.y + free.height || placed.y + placed.height <= free.y)
+		{
+			i++;
+			continue;
+		}
+
+		// up to four maximal rectangles survive around the placed one
+		if (placed.x > free.x)
+		{
+			Rect left = { free.x, free.y, placed.x - free.x, free.height };
+			freeRects.push_back(left);
+		}
+		if (placed.x + placed.width < free.x + free.width)
+		{
+			Rect right = { placed.x + placed.width, free.y, free.x + free.width - placed.x - placed.width, free.height };
+			freeRects.push_back(right);
+		}
+		if (placed.y > free.y)
+		{
+			Rect below = { free.x, free.y, free.width, placed.y - free.y };
+			freeRects.push_back(below);
+		}
+		if (placed.y + placed.height < free.y + free.height)
+		{
+			Rect above = { free.x, placed.y + placed.height, free.width, free.y + free.height - placed.y - placed.height };
+			freeRects.push_back(above);
+		}
+
+		// swap-remove; the swapped in element is either unvisited or newly pushed past count
+		freeRects[i] = freeRects.back();
+		freeRects.pop_back();
+		if (freeRects.size() < count)
+			count--;
+	}
+}
+
+void RectPacker::pruneFreeRects()
+{
+	for (size_t i = 0; i < freeRects.size(); i++)
+	{
+		for (size_t j = i + 1; j < freeRects.size();)
+		{
+			const Rect& a = freeRects[i];
+			const Rect& b = freeRects[j];
+			if (a.x >= b.x && a.y >= b.y && a.x + a.width <= b.x + b.width && a.y + a.height <= b.y + b.height)
+			{
+				// a lies inside b
+				freeRects.erase(freeRects.begin() + i);
+				i--;
+				break;
+			}
+			if (b.x >= a.x && b.y >= a.y && b.x + b.width <= a.x + a.width && b.y + b.height <= a.y + a.height)
+				freeRects.erase(freeRects.begin() + j);
+			else
+				j++;
+		}
+	}
+}
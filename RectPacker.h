@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// placement strategy used by RectPacker
+enum class PackHeuristic
+{
+	Skyline,  // bottom-left on a skyline of filled columns; fast, a few percent more waste
+	MaxRects  // best short side fit over all maximal free rectangles; tightest packing
+};
+
+// Packs rectangles into a fixed size bin one at a time. Every insert is
+// placed immediately and never moved, so the packer can keep accepting
+// rectangles as they arrive instead of needing the whole set up front.
+class RectPacker
+{
+public:
+	struct Rect
+	{
+		int x, y, width, height;
+	};
+
+	RectPacker(int width, int height, PackHeuristic heuristic = PackHeuristic::MaxRects);
+
+	// find room for a width x height rectangle; returns false when the bin has no space left for it
+	bool insert(int width, int height, Rect& placed);
+	// forget every placement
+	void reset();
+	// fraction of the bin area covered by placed rectangles
+	float occupancy() const;
+
+	int width() const { return binWidth; }
+	int height() const { return binHeight; }
+
+private:
+	// one horizontal run of the skyline: columns x..x+width-1 are filled up to y
+	struct SkylineNode
+	{
+		int x, y, width;
+	};
+
+	int binWidth, binHeight;
+	PackHeuristic heuristic;
+	long long usedArea;
+
+	std::vector<SkylineNode> skyline;
+	std::vector<Rect> freeRects;
+
+	bool insertSkyline(int width, int height, Rect& placed);
+	// y the rectangle would rest at if its left edge sat on node index, or -1 if it doesn't fit there
+	int skylineFit(size_t index, int width, int height) const;
+	void addSkylineLevel(size_t index, const Rect& placed);
+
+	bool insertMaxRects(int width, int height, Rect& placed);
+	// cut placed out of every free rectangle it overlaps, then drop rectangles contained in others
+	void splitFreeRects(const Rect& placed);
+	void pruneFreeRects();
+};
@@ -0,0 +1,116 @@
+#include "RenderQueue.h"
+
+RenderQueue::RenderQueue(size_t capacity)
+	: draws(0), commandBuffer(0), dataBuffer(0), commandCapacity(0), dataCapacity(0), storageAlignment(256)
+{
+	glCreateBuffers(1, &commandBuffer);
+	glCreateBuffers(1, &dataBuffer);
+	reserve(commandBuffer, commandCapacity, capacity * sizeof(DrawElementsIndirectCommand));
+	reserve(dataBuffer, dataCapacity, capacity * sizeof(QuadInstance));
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+}
+
+void RenderQueue::submit(Shader& shader, unsigned int vao, const QuadInstance& data, GLuint count, GLuint firstIndex,
+	GLint baseVertex)
+{
+	// a handful of buckets per frame, a linear search beats hashing
+	Bucket* bucket = NULL;
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		if (buckets[i].shader == &shader && buckets[i].vao == vao)
+		{
+			bucket = &buckets[i];
+			break;
+		}
+	}
+	if (!bucket)
+	{
+		buckets.push_back(Bucket());
+		bucket = &buckets.back();
+		bucket->shader = &shader;
+		bucket->vao = vao;
+	}
+
+	DrawElementsIndirectCommand command = { count, 1, firstIndex, baseVertex, 0 };
+	bucket->commands.push_back(command);
+	bucket->data.push_back(data);
+	draws++;
+}
+
+void RenderQueue::flush()
+{
+	if (!draws)
+		return;
+
+	// commands back to back; each bucket's records start on an SSBO binding boundary so gl_DrawID indexes from 0
+	std::vector<size_t> dataOffsets(buckets.size());
+	size_t dataSize = 0;
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		dataSize = (dataSize + storageAlignment - 1) / storageAlignment * storageAlignment;
+		dataOffsets[i] = dataSize;
+		dataSize += buckets[i].data.size() * sizeof(QuadInstance);
+	}
+	staging.resize(dataSize);
+	for (size_t i = 0; i < buckets.size(); i++)
+		memcpy(staging.data() + dataOffsets[i], buckets[i].data.data(), buckets[i].data.size() * sizeof(QuadInstance));
+
+	reserve(dataBuffer, dataCapacity, dataSize);
+	glNamedBufferSubData(dataBuffer, 0, dataSize, staging.data());
+
+	reserve(commandBuffer, commandCapacity, draws * sizeof(DrawElementsIndirectCommand));
+	size_t commandOffset = 0;
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		size_t size = buckets[i].commands.size() * sizeof(DrawElementsIndirectCommand);
+		glNamedBufferSubData(commandBuffer, commandOffset, size, buckets[i].commands.data());
+		commandOffset += size;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+
+	commandOffset = 0;
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		Bucket& bucket = buckets[i];
+		if (bucket.commands.empty())
+			continue;
+		bucket.shader->use();
+		bucket.shader->setBool("instanced", true);
+		bucket.shader->setBool("indirect", true);
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, InstancedQuads::INSTANCE_BINDING, dataBuffer, dataOffsets[i],
+			bucket.data.size() * sizeof(QuadInstance));
+		GLState::bindVertexArray(bucket.vao);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset, (GLsizei)bucket.commands.size(), 0);
+		bucket.shader->setBool("indirect", false);
+		bucket.shader->setBool("instanced", false);
+		commandOffset += bucket.commands.size() * sizeof(DrawElementsIndirectCommand);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	// keep the buckets and their capacity, most frames submit the same mix of state
+	for (size_t i = 0; i < buckets.size(); i++)
+	{
+		buckets[i].commands.clear();
+		buckets[i].data.clear();
+	}
+	draws = 0;
+}
+
+void RenderQueue::dispose()
+{
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteBuffers(1, &dataBuffer);
+	commandBuffer = dataBuffer = 0;
+	buckets.clear();
+}
+
+void RenderQueue::reserve(unsigned int buffer, size_t& capacity, size_t size)
+{
+	size_t wanted = capacity ? capacity : 1;
+	while (wanted < size)
+		wanted *= 2;
+	// orphan every frame so uploads never wait for the GPU to finish last frame's draws
+	glNamedBufferData(buffer, wanted, NULL, GL_DYNAMIC_DRAW);
+	capacity = wanted;
+}
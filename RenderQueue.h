@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <vector>
+
+#include "Shader.h"
+#include "InstancedQuads.h"
+
+// one record of GL_DRAW_INDIRECT_BUFFER as glMultiDrawElementsIndirect reads it
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// Collects draws over a frame and submits them with one
+// glMultiDrawElementsIndirect per state bucket (shader and vertex array).
+// Each draw carries a QuadInstance record; records are uploaded next to the
+// commands and BrickTexture.vs fetches its own with gl_DrawID while the
+// `instanced` and `indirect` uniforms are set. All commands and records of a
+// frame go to the GPU in two buffer uploads, whatever the number of objects.
+class RenderQueue
+{
+public:
+	explicit RenderQueue(size_t capacity = 1024);
+
+	// queue count indices from firstIndex of vao's element buffer, drawn with shader and data
+	void submit(Shader& shader, unsigned int vao, const QuadInstance& data, GLuint count = 6, GLuint firstIndex = 0,
+		GLint baseVertex = 0);
+	// upload and draw everything queued, one multi-draw per bucket, then start over
+	void flush();
+	size_t drawCount() const { return draws; }
+	size_t bucketCount() const { return buckets.size(); }
+	void dispose();
+
+private:
+	struct Bucket
+	{
+		Shader* shader;
+		unsigned int vao;
+		std::vector<DrawElementsIndirectCommand> commands;
+		std::vector<QuadInstance> data;
+	};
+
+	std::vector<Bucket> buckets;
+	size_t draws;
+	unsigned int commandBuffer;
+	unsigned int dataBuffer;
+	size_t commandCapacity, dataCapacity;  // bytes
+	std::vector<unsigned char> staging;
+	GLint storageAlignment;
+
+	static void reserve(unsigned int buffer, size_t& capacity, size_t size);
+};
@@ -0,0 +1,67 @@
+#include "RenderThread.h"
+
+RenderThread::RenderThread(GLFWwindow* window, const std::function<void(RenderThread&)>& body)
+	: window(window), finished(false), stopping(false)
+{
+	// the context may only be current on one thread, release it before the render thread takes it
+	glfwMakeContextCurrent(NULL);
+	thread = std::thread(&RenderThread::run, this, body);
+}
+
+RenderThread::~RenderThread()
+{
+	stop();
+}
+
+bool RenderThread::submit(FramePacket&& packet)
+{
+	bool pushed = queue.push(std::move(packet));
+	if (!pushed)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeup.wait(lock, [&] { return (pushed = queue.push(std::move(packet))) || !running(); });
+	}
+	if (pushed)
+		wake();
+	return pushed && running();
+}
+
+bool RenderThread::next(FramePacket& packet)
+{
+	bool popped = queue.pop(packet);
+	if (!popped)
+	{
+		// a packet pushed just before stop() is still drawn
+		std::unique_lock<std::mutex> lock(mutex);
+		wakeup.wait(lock, [&] { return (popped = queue.pop(packet)) || stopping.load(std::memory_order_acquire); });
+	}
+	if (popped)
+		wake();
+	return popped;
+}
+
+void RenderThread::stop()
+{
+	stopping.store(true, std::memory_order_release);
+	wake();
+	if (thread.joinable())
+		thread.join();
+}
+
+void RenderThread::run(std::function<void(RenderThread&)> body)
+{
+	glfwMakeContextCurrent(window);
+	body(*this);
+	glfwMakeContextCurrent(NULL);
+	finished.store(true, std::memory_order_release);
+	wake();
+}
+
+void RenderThread::wake()
+{
+	// taking the mutex orders the state change before a waiter's check, so the notify can't be lost
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+	}
+	wakeup.notify_all();
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "SpscQueue.h"
+
+// everything the render thread needs to draw one frame, produced by the main thread
+struct FramePacket
+{
+	uint64_t frame;
+	double time;                      // glfwGetTime() when the frame was simulated
+	int framebufferWidth, framebufferHeight;
+	std::vector<glm::mat4> transforms;  // one per object, from the simulation; empty when nothing moved
+};
+
+// Runs rendering on its own thread. The main thread keeps the window, polls
+// GLFW events, handles input and simulation and hands each frame over as a
+// FramePacket; the render thread owns the GL context, loads resources and
+// draws packets as they arrive. The queue holds one packet, so the main
+// thread simulates frame N+1 while frame N is being submitted and swapped,
+// and waits only when it gets a full frame ahead. A blocking swap no longer
+// delays input handling. Packets pass through a lock-free queue; a side that
+// has to wait sleeps on a condition variable instead of spinning, so an idle
+// simulation or a swap blocked on vsync doesn't keep a core busy.
+class RenderThread
+{
+public:
+	// the window whose context the render thread makes current
+	GLFWwindow* window;
+
+	// body runs on the new thread with the context current; it loops on next() and returns to end rendering
+	RenderThread(GLFWwindow* window, const std::function<void(RenderThread&)>& body);
+	~RenderThread();
+
+	// main thread: hand over the next frame, waiting while the previous one is still queued;
+	// returns false once the render thread has exited
+	bool submit(FramePacket&& packet);
+	// render thread: wait for the next frame; returns false when stop() was called and nothing is left
+	bool next(FramePacket& packet);
+	// false once body has returned (initialisation failure, or the render side chose to quit)
+	bool running() const { return !finished.load(std::memory_order_acquire); }
+	// main thread: let the render thread drain the queue and exit, then join it
+	void stop();
+
+private:
+	SpscQueue<FramePacket, 1> queue;
+	std::atomic<bool> finished;
+	std::atomic<bool> stopping;
+	std::mutex mutex;  // only guards sleeping on wakeup
+	std::condition_variable wakeup;
+	std::thread thread;
+
+	void run(std::function<void(RenderThread&)> body);
+	// wake the other side after pushing, popping, stopping or finishing
+	void wake();
+};
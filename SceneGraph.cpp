@@ -0,0 +1,107 @@
+#include "SceneGraph.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_GRAPH_SSE
+#include <xmmintrin.h>
+#endif
+
+SceneGraph::SceneGraph(size_t capacity)
+	: local(capacity), firstMoved(NOTHING_MOVED)
+{
+	parents.reserve(capacity);
+	locals.reserve(capacity);
+	worlds.reserve(capacity);
+	changed.reserve(capacity);
+}
+
+unsigned int SceneGraph::create(int parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	if (parent != NO_PARENT && (parent < 0 || (size_t)parent >= parents.size()))
+	{
+		std::cout << "ERROR::SCENE_GRAPH::UNKNOWN_PARENT " << parent << std::endl;
+		parent = NO_PARENT;
+	}
+	unsigned int node = local.create(position, rotation, scale);
+	parents.push_back(parent);
+	locals.push_back(glm::mat4(1.0f));
+	worlds.push_back(glm::mat4(1.0f));
+	changed.push_back(0);
+	moved(node);
+	return node;
+}
+
+void SceneGraph::setPosition(unsigned int node, const glm::vec3& position)
+{
+	local.setPosition(node, position);
+	moved(node);
+}
+
+void SceneGraph::setRotation(unsigned int node, const glm::quat& rotation)
+{
+	local.setRotation(node, rotation);
+	moved(node);
+}
+
+void SceneGraph::setScale(unsigned int node, const glm::vec3& scale)
+{
+	local.setScale(node, scale);
+	moved(node);
+}
+
+void SceneGraph::moved(unsigned int node)
+{
+	if (firstMoved == NOTHING_MOVED || node < firstMoved)
+		firstMoved = node;
+}
+
+size_t SceneGraph::update(JobSystem* jobs)
+{
+	if (firstMoved == NOTHING_MOVED)
+		return 0;
+	size_t count = parents.size();
+
+	// read the moved flags before the store clears them; nothing before firstMoved moved
+	for (size_t i = firstMoved; i < count; i++)
+		changed[i] = local.isDirty((unsigned int)i) ? 1 : 0;
+	local.update(locals, jobs);
+
+	// parents come first, so their world matrix and changed flag are final by the time a child reads them
+	size_t recomputed = 0;
+	for (size_t i = firstMoved; i < count; i++)
+	{
+		int parent = parents[i];
+		if (parent != NO_PARENT && changed[parent])
+			changed[i] = 1;
+		if (!changed[i])
+			continue;
+		if (parent == NO_PARENT)
+			worlds[i] = locals[i];
+		else
+			multiply(worlds[parent], locals[i], worlds[i]);
+		recomputed++;
+	}
+
+	memset(&changed[firstMoved], 0, count - firstMoved);
+	firstMoved = NOTHING_MOVED;
+	return recomputed;
+}
+
+void SceneGraph::multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#if defined(SCENE_GRAPH_SSE)
+	// column j of the product is the columns of a weighted by column j of b
+	__m128 a0 = _mm_loadu_ps(&a[0][0]), a1 = _mm_loadu_ps(&a[1][0]), a2 = _mm_loadu_ps(&a[2][0]), a3 = _mm_loadu_ps(&a[3][0]);
+	for (int j = 0; j < 4; j++)
+	{
+		__m128 column = _mm_mul_ps(a0, _mm_set1_ps(b[j][0]));
+		column = _mm_add_ps(column, _mm_mul_ps(a1, _mm_set1_ps(b[j][1])));
+		column = _mm_add_ps(column, _mm_mul_ps(a2, _mm_set1_ps(b[j][2])));
+		column = _mm_add_ps(column, _mm_mul_ps(a3, _mm_set1_ps(b[j][3])));
+		_mm_storeu_ps(&out[j][0], column);
+	}
+#else
+	out = a * b;
+#endif
+}
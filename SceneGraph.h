@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "JobSystem.h"
+#include "TransformStore.h"
+
+// Transform hierarchy stored as flat arrays in topological order: a node is
+// created after its parent, so its index is larger and one forward pass over
+// the arrays sees every parent's world matrix before its children read it.
+// Local position, rotation and scale live in a TransformStore.
+//
+// Setters mark the node moved. update() rebuilds the local matrices of moved
+// nodes, then walks forward from the first moved node: a node is recomputed
+// when it moved itself or its parent was recomputed in this pass, so moving
+// one node touches only its subtree and everything before it is skipped.
+// Nodes are never removed or reparented; that would break the ordering.
+class SceneGraph
+{
+public:
+	static const int NO_PARENT = -1;
+
+	explicit SceneGraph(size_t capacity = 1024);
+
+	// add a node under parent (an existing node, or NO_PARENT for a root); returns its index
+	unsigned int create(int parent = NO_PARENT, const glm::vec3& position = glm::vec3(0.0f),
+		const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+	size_t size() const { return parents.size(); }
+	int parent(unsigned int node) const { return parents[node]; }
+
+	// local transform, relative to the parent
+	void setPosition(unsigned int node, const glm::vec3& position);
+	void setRotation(unsigned int node, const glm::quat& rotation);
+	void setScale(unsigned int node, const glm::vec3& scale);
+	glm::vec3 position(unsigned int node) const { return local.position(node); }
+	glm::quat rotation(unsigned int node) const { return local.rotation(node); }
+	glm::vec3 scale(unsigned int node) const { return local.scale(node); }
+
+	// recompute the world matrices of moved nodes and their descendants; jobs builds the local
+	// matrices in parallel, propagation stays on this thread. Returns the number of world matrices recomputed
+	size_t update(JobSystem* jobs = NULL);
+	const glm::mat4& world(unsigned int node) const { return worlds[node]; }
+	// every world matrix, indexed by node
+	const std::vector<glm::mat4>& worldMatrices() const { return worlds; }
+
+private:
+	static const size_t NOTHING_MOVED = (size_t)-1;
+
+	TransformStore local;
+	std::vector<int> parents;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> changed;  // per node, during update(): the world matrix is being recomputed
+	size_t firstMoved;             // lowest node moved since the last update(), NOTHING_MOVED if none
+
+	void moved(unsigned int node);
+	// out = a * b for column-major 4x4 matrices; out may not alias a or b
+	static void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out);
+};
@@ -14,11 +14,34 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	compileShader(vertex, vertexCode, GL_VERTEX_SHADER, "VERTEX");
 	compileShader(fragment, fragmentCode, GL_FRAGMENT_SHADER, "FRAGMENT");
 
-	int success;
-	char infoLog[512];
 	ID = glCreateProgram();
 	glAttachShader(ID, vertex);
 	glAttachShader(ID, fragment);
+	linkProgram();
+	// delete shaders; they’re linked into our program and no longer necessary
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+}
+
+Shader::Shader(const char* computePath)
+{
+	std::string cCode = readFromFile(computePath);
+	const char* computeCode = cCode.c_str();
+	std::cout << computeCode << std::endl;
+
+	unsigned int compute;
+	compileShader(compute, computeCode, GL_COMPUTE_SHADER, "COMPUTE");
+
+	ID = glCreateProgram();
+	glAttachShader(ID, compute);
+	linkProgram();
+	glDeleteShader(compute);
+}
+
+void Shader::linkProgram()
+{
+	int success;
+	char infoLog[512];
 	glLinkProgram(ID);
 	// print linking errors if any
 	glGetProgramiv(ID, GL_LINK_STATUS, &success);
@@ -28,9 +51,6 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" <<
 			infoLog << std::endl;
 	}
-	// delete shaders; they’re linked into our program and no longer necessary
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
 }
 
 std::string Shader::readFromFile(const char* shaderPath) 
@@ -74,11 +94,12 @@ void Shader::compileShader(unsigned int &shader, const char* shaderCode, GLenum
 
 void Shader::use()
 {
-	glUseProgram(ID);
+	GLState::useProgram(ID);
 }
 
 void Shader::dispose()
 {
+	GLState::programDeleted(ID);
 	glDeleteProgram(ID);
 }
 
@@ -7,6 +7,8 @@
 #include <sstream>
 #include <iostream>
 
+#include "GLState.h"
+
 class Shader
 {
 public:
@@ -14,7 +16,9 @@ public:
 	unsigned int ID;
 	// constructor reads and builds the shader
 	Shader(const char* vertexPath, const char* fragmentPath);
-	// use/activate the shader
+	// compute program: reads and builds a single compute shader
+	explicit Shader(const char* computePath);
+	// use/activate the shader, skipped by GLState when it is already current
 	void use();
 	void dispose();
 	// utility uniform functions
@@ -26,4 +30,5 @@ private:
 	// read from file
 	std::string readFromFile(const char* shaderPath);
 	void compileShader(unsigned int& shader, const char* shaderCode, GLenum shaderType, const char* type);
+	void linkProgram();
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 460 core
+
+out vec4 FragColor;
+in vec3 ourColor;
+in vec2 TexCoord;
+// the texture of the current SpriteBatch run, bound to unit 0
+uniform sampler2D spriteTexture;
+
+void main()
+{
+    FragColor = texture(spriteTexture, TexCoord) * vec4(ourColor, 1.0);
+}
@@ -0,0 +1,125 @@
+#include "SpriteBatch.h"
+
+SpriteBatch::SpriteBatch(BufferRing& ring, size_t maxSprites)
+	: ring(ring), maxSprites(maxSprites), VAO(0), EBO(0)
+{
+	// the same two triangles as the box quad, for every sprite slot
+	std::vector<unsigned int> indices(maxSprites * 6);
+	for (size_t i = 0; i < maxSprites; i++)
+	{
+		unsigned int base = (unsigned int)(i * 4);
+		unsigned int quad[] = { base + 0, base + 1, base + 3, base + 1, base + 2, base + 3 };
+		std::copy(quad, quad + 6, indices.begin() + i * 6);
+	}
+
+	glCreateVertexArrays(1, &VAO);
+	glCreateBuffers(1, &EBO);
+	glNamedBufferStorage(EBO, indices.size() * sizeof(unsigned int), indices.data(), 0);
+	glVertexArrayElementBuffer(VAO, EBO);
+
+	// position, color and texture coord attributes as plain floats: the CPU rewrites them every frame
+	VertexFormat format;
+	format.add(0, 3, AttributeEncoding::Float).add(1, 3, AttributeEncoding::Float).add(2, 2, AttributeEncoding::Float);
+	format.apply(VAO, 0);
+	glVertexArrayVertexBuffer(VAO, 0, ring.ID, 0, VERTEX_SIZE);
+}
+
+void SpriteBatch::draw(Shader& shader, unsigned int texture, const glm::vec2& position, const glm::vec2& size,
+	float rotation, const glm::vec3& color, const glm::vec4& uv, int layer)
+{
+	Sprite sprite = { &shader, texture, layer, position, size, rotation, color, uv };
+	sprites.push_back(sprite);
+}
+
+void SpriteBatch::draw(Shader& shader, const AtlasRegion& region, const glm::vec2& position, const glm::vec2& size,
+	float rotation, const glm::vec3& color, int layer)
+{
+	draw(shader, region.texture, position, size, rotation, color, glm::vec4(region.u0, region.v0, region.u1, region.v1),
+		layer);
+}
+
+int SpriteBatch::flush()
+{
+	if (sprites.empty())
+		return 0;
+
+	order.resize(sprites.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = (unsigned int)i;
+	std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b)
+	{
+		const Sprite& x = sprites[a];
+		const Sprite& y = sprites[b];
+		if (x.layer != y.layer)
+			return x.layer < y.layer;
+		if (x.shader != y.shader)
+			return x.shader->ID < y.shader->ID;
+		return x.texture < y.texture;
+	});
+
+	size_t offset;
+	float* vertices = (float*)ring.allocate(sprites.size() * 4 * VERTEX_SIZE, offset, VERTEX_SIZE);
+	if (!vertices)
+	{
+		std::cout << "ERROR::SPRITE_BATCH::RING_FULL " << sprites.size() << " sprites" << std::endl;
+		sprites.clear();
+		return 0;
+	}
+	for (size_t i = 0; i < order.size(); i++)
+		expand(sprites[order[i]], vertices + i * 4 * FLOATS_PER_VERTEX);
+
+	GLState::bindVertexArray(VAO);
+	int drawCalls = 0;
+	GLint firstVertex = (GLint)(offset / VERTEX_SIZE);
+	for (size_t start = 0; start < order.size();)
+	{
+		// extend the run while shader and texture stay the same (layers only order runs)
+		const Sprite& first = sprites[order[start]];
+		size_t end = start + 1;
+		while (end < order.size() && end - start < maxSprites && sprites[order[end]].shader == first.shader
+			&& sprites[order[end]].texture == first.texture)
+			end++;
+
+		// GLState skips the program and texture binds when consecutive runs share them
+		first.shader->use();
+		GLState::bindTexture(0, first.texture);
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)((end - start) * 6), GL_UNSIGNED_INT, 0,
+			firstVertex + (GLint)(start * 4));
+		drawCalls++;
+		start = end;
+	}
+
+	sprites.clear();
+	return drawCalls;
+}
+
+void SpriteBatch::dispose()
+{
+	GLState::vertexArrayDeleted(VAO);
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &EBO);
+	VAO = EBO = 0;
+}
+
+void SpriteBatch::expand(const Sprite& sprite, float* vertices)
+{
+	float c = std::cos(sprite.rotation), s = std::sin(sprite.rotation);
+	float hx = sprite.size.x * 0.5f, hy = sprite.size.y * 0.5f;
+	// corners in boxData order: top right, bottom right, bottom left, top left
+	const float corners[4][2] = { { hx, hy }, { hx, -hy }, { -hx, -hy }, { -hx, hy } };
+	const float uvs[4][2] = {
+		{ sprite.uv.z, sprite.uv.w }, { sprite.uv.z, sprite.uv.y }, { sprite.uv.x, sprite.uv.y }, { sprite.uv.x, sprite.uv.w }
+	};
+	for (int i = 0; i < 4; i++)
+	{
+		float* v = vertices + i * FLOATS_PER_VERTEX;
+		v[0] = sprite.position.x + corners[i][0] * c - corners[i][1] * s;
+		v[1] = sprite.position.y + corners[i][0] * s + corners[i][1] * c;
+		v[2] = 0.0f;
+		v[3] = sprite.color.x;
+		v[4] = sprite.color.y;
+		v[5] = sprite.color.z;
+		v[6] = uvs[i][0];
+		v[7] = uvs[i][1];
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Shader.h"
+#include "BufferRing.h"
+#include "TextureAtlas.h"
+#include "VertexFormat.h"
+
+// Batches 2D sprites into as few draw calls as possible. Sprites are
+// collected during the frame, sorted by layer, then shader, then texture
+// (stable, so equal keys keep their submission order), expanded on the CPU
+// into four vertices each in the boxData layout (position, color, texcoord:
+// 8 floats) and written straight into a BufferRing. A static index buffer
+// holds the two triangles of every possible quad, so each run of sprites
+// sharing shader and texture is one glDrawElementsBaseVertex.
+//
+// The shader is expected to take the quad layout (BrickTexture.vs with its
+// transform as the projection, and Sprite.fs) and sample unit 0.
+class SpriteBatch
+{
+public:
+	static const int FLOATS_PER_VERTEX = 8;
+	static const int VERTEX_SIZE = FLOATS_PER_VERTEX * sizeof(float);
+
+	// maxSprites bounds one draw call (the index buffer size), not the sprites per frame
+	SpriteBatch(BufferRing& ring, size_t maxSprites = 16384);
+
+	// queue a sprite centred on position; uv is (u0, v0, u1, v1) of texture
+	void draw(Shader& shader, unsigned int texture, const glm::vec2& position, const glm::vec2& size, float rotation = 0.0f,
+		const glm::vec3& color = glm::vec3(1.0f), const glm::vec4& uv = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), int layer = 0);
+	// queue a sprite showing an image packed into a TextureAtlas
+	void draw(Shader& shader, const AtlasRegion& region, const glm::vec2& position, const glm::vec2& size,
+		float rotation = 0.0f, const glm::vec3& color = glm::vec3(1.0f), int layer = 0);
+	// sort, write the vertices into the ring and draw everything queued; returns the number of draw calls
+	int flush();
+	size_t size() const { return sprites.size(); }
+	void dispose();
+
+private:
+	struct Sprite
+	{
+		Shader* shader;
+		unsigned int texture;
+		int layer;
+		glm::vec2 position, size;
+		float rotation;
+		glm::vec3 color;
+		glm::vec4 uv;
+	};
+
+	BufferRing& ring;
+	size_t maxSprites;
+	unsigned int VAO;
+	unsigned int EBO;
+	std::vector<Sprite> sprites;
+	std::vector<unsigned int> order;
+
+	static void expand(const Sprite& sprite, float* vertices);
+};
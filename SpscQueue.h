@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded single-producer single-consumer queue without locks. One thread
+// pushes, one other thread pops; each side only writes its own index, so
+// neither ever waits on the other inside push or pop. Both return false
+// instead of blocking when the queue is full or empty, the caller decides how
+// to wait. The indices sit on separate cache lines so the two threads don't
+// bounce one line between cores.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+	SpscQueue()
+		: head(0), tail(0)
+	{
+	}
+
+	// producer thread
+	bool push(T&& item)
+	{
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+		slots[t % Capacity] = std::move(item);
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer thread
+	bool pop(T& item)
+	{
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire))
+			return false;
+		item = std::move(slots[h % Capacity]);
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// approximate when called while the other side is running
+	size_t size() const
+	{
+		return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+	}
+
+private:
+	static const size_t CACHE_LINE = 64;
+
+	T slots[Capacity];
+	char padding0[CACHE_LINE];
+	std::atomic<size_t> head;  // next slot to pop, written by the consumer
+	char padding1[CACHE_LINE - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> tail;  // next slot to push, written by the producer
+	char padding2[CACHE_LINE - sizeof(std::atomic<size_t>)];
+};
@@ -0,0 +1,129 @@
+#include "Texture.h"
+#include "BlockCompressor.h"
+
+Texture::Texture()
+	: ID(0), width(0), height(0), levels(0), internalFormat(GL_RGBA8), mips(MipMode::None)
+{
+	glCreateTextures(GL_TEXTURE_2D, 1, &ID);
+}
+
+void Texture::allocate(int width, int height, GLenum internalFormat, MipMode mips, int maxLevels)
+{
+	this->width = width;
+	this->height = height;
+	this->internalFormat = internalFormat;
+	this->mips = mips;
+	// don't pay for levels that GL_LINEAR filtering never samples
+	levels = mips == MipMode::None ? 1 : mipLevels(width, height);
+	if (maxLevels > 0 && levels > maxLevels)
+		levels = maxLevels;
+
+	glTextureStorage2D(ID, levels, internalFormat, width, height);
+	glTextureParameteri(ID, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(ID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(ID, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+void Texture::upload(int level, const void* pixels) const
+{
+	int w = levelDimension(width, level), h = levelDimension(height, level);
+	if (isCompressed(internalFormat))
+		glCompressedTextureSubImage2D(ID, level, 0, 0, w, h, internalFormat, (GLsizei)imageSize(w, h, internalFormat), pixels);
+	else
+		glTextureSubImage2D(ID, level, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+}
+
+void Texture::uploadChain(const void* pixels) const
+{
+	// pixels may be a PBO offset, so only do pointer arithmetic on it
+	const char* level = (const char*)pixels;
+	for (int i = 0; i < levels; i++)
+	{
+		upload(i, level);
+		level += imageSize(levelDimension(width, i), levelDimension(height, i), internalFormat);
+	}
+}
+
+void Texture::generateMipmaps() const
+{
+	if (levels < 2 || isCompressed(internalFormat))
+		return;
+	glGenerateTextureMipmap(ID);
+}
+
+size_t Texture::byteSize() const
+{
+	return chainSize(width, height, levels, internalFormat);
+}
+
+void Texture::dispose()
+{
+	GLState::textureDeleted(ID);
+	glDeleteTextures(1, &ID);
+	ID = 0;
+}
+
+int Texture::mipLevels(int width, int height)
+{
+	int size = width > height ? width : height;
+	int levels = 1;
+	while (size > 1)
+	{
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+int Texture::levelDimension(int size, int level)
+{
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+bool Texture::isCompressed(GLenum internalFormat)
+{
+	return internalFormat != GL_RGBA8 && internalFormat != GL_SRGB8_ALPHA8;
+}
+
+size_t Texture::imageSize(int width, int height, GLenum internalFormat)
+{
+	size_t blocks = (size_t)((width + 3) / 4) * ((height + 3) / 4);
+	switch (internalFormat)
+	{
+	case GL_RGBA8:
+	case GL_SRGB8_ALPHA8:
+		return (size_t)width * height * 4;
+	case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+	case GL_COMPRESSED_RGB8_ETC2:
+	case GL_COMPRESSED_SRGB8_ETC2:
+		return blocks * 8;
+	default:
+		// BC3, BC7 and ETC2 RGBA: 16 bytes per block
+		return blocks * 16;
+	}
+}
+
+size_t Texture::chainSize(int width, int height, int levels, GLenum internalFormat)
+{
+	size_t size = 0;
+	for (int i = 0; i < levels; i++)
+		size += imageSize(levelDimension(width, i), levelDimension(height, i), internalFormat);
+	return size;
+}
+
+bool Texture::hasExtension(const char* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++)
+	{
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstring>
+
+#include "GLState.h"
+
+// how a texture's mip chain is produced
+enum class MipMode
+{
+	None,        // single level, sample with GL_LINEAR
+	Gpu,         // full chain filled by glGenerateMipmap after level 0 is uploaded
+	Precomputed  // full chain uploaded from CPU-built levels
+};
+
+// 2D texture with immutable storage (glTextureStorage2D). The internal format is
+// explicit (GL_RGBA8, GL_SRGB8_ALPHA8 or one of the BlockCompressor formats)
+// and only the mip levels that will actually be sampled are allocated. All
+// setup and uploads go through direct state access, so they never change the
+// texture bound to any unit.
+class Texture
+{
+public:
+	// the texture ID
+	unsigned int ID;
+	int width, height;
+	int levels;
+	GLenum internalFormat;
+	MipMode mips;
+
+	// creates the texture object; storage is allocated later by allocate()
+	Texture();
+	// allocate immutable storage and set matching filtering; maxLevels > 0 truncates the chain
+	void allocate(int width, int height, GLenum internalFormat, MipMode mips, int maxLevels = 0);
+	// upload one level (RGBA8 pixels or compressed blocks), from client memory or from an offset into the bound GL_PIXEL_UNPACK_BUFFER
+	void upload(int level, const void* pixels) const;
+	// upload every level from one buffer holding the chain level after level (see chainSize)
+	void uploadChain(const void* pixels) const;
+	// fill levels 1..n from level 0 (MipMode::Gpu, uncompressed formats only)
+	void generateMipmaps() const;
+	// GPU memory taken by the allocated levels
+	size_t byteSize() const;
+	void dispose();
+
+	// number of levels in a full chain down to 1x1
+	static int mipLevels(int width, int height);
+	static int levelDimension(int size, int level);
+	static bool isCompressed(GLenum internalFormat);
+	// bytes of one level: 4 per texel, or 8/16 per 4x4 block for compressed formats
+	static size_t imageSize(int width, int height, GLenum internalFormat);
+	// bytes of a tightly packed chain of the given number of levels
+	static size_t chainSize(int width, int height, int levels, GLenum internalFormat = GL_RGBA8);
+	// whether the current context exposes a GL extension, e.g. "GL_ARB_bindless_texture"
+	static bool hasExtension(const char* name);
+};
@@ -0,0 +1,110 @@
+#include "TextureAtlas.h"
+
+TextureAtlas::TextureAtlas(int pageSize, int padding, MipMode mips, PackHeuristic heuristic, GLenum internalFormat)
+	: pageSize(pageSize), padding(padding < 0 ? 0 : padding), mips(mips), heuristic(heuristic),
+	internalFormat(internalFormat)
+{
+	// images are copied in with glTextureSubImage2D, which can't write part of a compressed block
+	if (Texture::isCompressed(internalFormat))
+	{
+		std::cout << "ERROR::TEXTURE_ATLAS::COMPRESSED_FORMAT_NOT_SUPPORTED, using GL_RGBA8" << std::endl;
+		this->internalFormat = GL_RGBA8;
+	}
+	// levels are rebuilt from the pasted level 0, there is no CPU chain to upload
+	if (mips == MipMode::Precomputed)
+		this->mips = MipMode::Gpu;
+}
+
+bool TextureAtlas::insert(const unsigned char* pixels, int width, int height, AtlasRegion& region)
+{
+	int paddedWidth = width + 2 * padding, paddedHeight = height + 2 * padding;
+	if (paddedWidth > pageSize || paddedHeight > pageSize)
+	{
+		std::cout << "ERROR::TEXTURE_ATLAS::IMAGE_LARGER_THAN_PAGE " << width << "x" << height << std::endl;
+		return false;
+	}
+
+	// first fit over the open pages keeps early pages filling up with small images
+	RectPacker::Rect placed;
+	size_t index = 0;
+	for (; index < pages.size(); index++)
+	{
+		if (pages[index].packer.insert(paddedWidth, paddedHeight, placed))
+			break;
+	}
+	if (index == pages.size())
+	{
+		addPage().packer.insert(paddedWidth, paddedHeight, placed);
+	}
+
+	Page& page = pages[index];
+	blit(page, placed, pixels, width, height);
+	page.dirty = true;
+
+	region.page = (int)index;
+	region.texture = page.texture.ID;
+	region.x = placed.x + padding;
+	region.y = placed.y + padding;
+	region.width = width;
+	region.height = height;
+	region.u0 = (float)region.x / pageSize;
+	region.v0 = (float)region.y / pageSize;
+	region.u1 = (float)(region.x + width) / pageSize;
+	region.v1 = (float)(region.y + height) / pageSize;
+	return true;
+}
+
+void TextureAtlas::flush()
+{
+	for (Page& page : pages)
+	{
+		if (!page.dirty)
+			continue;
+		page.texture.generateMipmaps();
+		page.dirty = false;
+	}
+}
+
+void TextureAtlas::dispose()
+{
+	for (Page& page : pages)
+		page.texture.dispose();
+	pages.clear();
+}
+
+TextureAtlas::Page& TextureAtlas::addPage()
+{
+	int maxLevels = 1;
+	while ((2 << maxLevels) - 1 <= padding)
+		maxLevels++;
+
+	Page page = { Texture(), RectPacker(pageSize, pageSize, heuristic), false };
+	page.texture.allocate(pageSize, pageSize, internalFormat, mips, maxLevels);
+	// storage contents are undefined, start from transparent black so gaps sample as nothing
+	glClearTexImage(page.texture.ID, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	pages.push_back(page);
+	return pages.back();
+}
+
+void TextureAtlas::blit(const Page& page, const RectPacker::Rect& placed, const unsigned char* pixels, int width, int height)
+{
+	// clamp every padded texel to the nearest image texel
+	scratch.resize((size_t)placed.width * placed.height * 4);
+	for (int y = 0; y < placed.height; y++)
+	{
+		int sy = y - padding;
+		sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+		const unsigned char* srcRow = pixels + (size_t)sy * width * 4;
+		unsigned char* dstRow = scratch.data() + (size_t)y * placed.width * 4;
+
+		for (int x = 0; x < padding; x++)
+			memcpy(dstRow + x * 4, srcRow, 4);
+		memcpy(dstRow + padding * 4, srcRow, (size_t)width * 4);
+		for (int x = padding + width; x < placed.width; x++)
+			memcpy(dstRow + x * 4, srcRow + (size_t)(width - 1) * 4, 4);
+	}
+
+	glTextureSubImage2D(page.texture.ID, 0, placed.x, placed.y, placed.width, placed.height, GL_RGBA, GL_UNSIGNED_BYTE,
+		scratch.data());
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "Texture.h"
+#include "RectPacker.h"
+
+// where an image ended up inside the atlas
+struct AtlasRegion
+{
+	int page;                // index of the page texture
+	unsigned int texture;    // GL name of that page
+	float u0, v0, u1, v1;    // texture coordinates of the image, padding excluded
+	int x, y, width, height; // texel rectangle of the image on the page
+};
+
+// Packs many small RGBA8 images into a few large page textures so quads
+// using different images can share one bind and be batched together.
+// Images are placed with RectPacker as they are inserted, a new page is
+// opened when the current ones are full.
+//
+// Every image is surrounded by `padding` texels that repeat its edge texels,
+// so bilinear and mipmapped sampling doesn't bleed in the neighbours. Level k
+// reads up to 2^(k+1) - 1 texels past the image edge, so pages only get the
+// levels that stay inside the padding: floor(log2(padding + 1)), 3 for 8.
+class TextureAtlas
+{
+public:
+	TextureAtlas(int pageSize = 2048, int padding = 8, MipMode mips = MipMode::Gpu,
+		PackHeuristic heuristic = PackHeuristic::MaxRects, GLenum internalFormat = GL_RGBA8);
+
+	// copy a width x height RGBA8 image (rows bottom to top, as GL expects) into the atlas.
+	// Returns false when the image doesn't fit in an empty page.
+	bool insert(const unsigned char* pixels, int width, int height, AtlasRegion& region);
+	// rebuild the mip levels of pages changed since the last call; call once after a batch of inserts
+	void flush();
+
+	size_t pageCount() const { return pages.size(); }
+	unsigned int pageTexture(size_t page) const { return pages[page].texture.ID; }
+	float occupancy(size_t page) const { return pages[page].packer.occupancy(); }
+	void dispose();
+
+private:
+	struct Page
+	{
+		Texture texture;
+		RectPacker packer;
+		bool dirty;
+	};
+
+	int pageSize;
+	int padding;
+	MipMode mips;
+	PackHeuristic heuristic;
+	GLenum internalFormat;
+	std::vector<Page> pages;
+	std::vector<unsigned char> scratch;
+
+	Page& addPage();
+	// upload the image with its edge texels extruded over the padding
+	void blit(const Page& page, const RectPacker::Rect& placed, const unsigned char* pixels, int width, int height);
+};
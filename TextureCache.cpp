@@ -0,0 +1,166 @@
+#include "TextureCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const char MAGIC[8] = { 'G', 'L', 'T', 'E', 'X', 'B', 'K', '\0' };
+
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+TextureCache::TextureCache(const std::string& directory)
+	: directory(directory)
+{
+	// an existing directory is fine, anything else shows up as failed stores later
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+#else
+	mkdir(directory.c_str(), 0755);
+#endif
+}
+
+Hash128 TextureCache::key(const Hash128& sourceHash, GLenum internalFormat, MipMode mips, MipFilter filter,
+	CompressionQuality quality, bool flipped)
+{
+	uint64_t options[5] = {
+		(uint64_t)internalFormat,
+		(uint64_t)mips,
+		mips == MipMode::Precomputed ? (uint64_t)filter : 0,
+		Texture::isCompressed(internalFormat) ? (uint64_t)quality : 0,
+		(uint64_t)flipped
+	};
+	return hashBytes(options, sizeof(options), sourceHash.low ^ (sourceHash.high * 0x9E3779B97F4A7C15ULL) ^ VERSION);
+}
+
+std::string TextureCache::pathFor(const Hash128& key) const
+{
+	return directory + "/" + key.toString() + ".btx";
+}
+
+bool TextureCache::load(const Hash128& key, Entry& entry) const
+{
+	if (!entry.file.open(pathFor(key)))
+		return false;
+
+	const MappedFile& file = entry.file;
+	if (file.size < sizeof(BakedHeader))
+		return false;
+	memcpy(&entry.header, file.data, sizeof(BakedHeader));
+	const BakedHeader& header = entry.header;
+	if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION
+		|| header.keyLow != key.low || header.keyHigh != key.high || header.levels == 0 || header.levels > 32)
+	{
+		std::cout << "ERROR::TEXTURE_CACHE::STALE_ENTRY " << pathFor(key) << std::endl;
+		return false;
+	}
+
+	size_t tableSize = header.levels * sizeof(BakedLevel);
+	size_t dataStart = alignUp(sizeof(BakedHeader) + tableSize, LEVEL_ALIGNMENT);
+	if (file.size < dataStart || file.size - dataStart < header.dataSize)
+		return false;
+	entry.levelTable = (const BakedLevel*)(file.data + sizeof(BakedHeader));
+	entry.data = file.data + dataStart;
+
+	for (uint32_t i = 0; i < header.levels; i++)
+	{
+		const BakedLevel& level = entry.levelTable[i];
+		size_t expected = Texture::imageSize(Texture::levelDimension(header.width, i), Texture::levelDimension(header.height, i), header.internalFormat);
+		if (level.size != expected || level.offset > header.dataSize || header.dataSize - level.offset < level.size)
+			return false;
+	}
+	return true;
+}
+
+bool TextureCache::store(const Hash128& key, GLenum internalFormat, MipMode mips, int width, int height, int levels,
+	const unsigned char* chain) const
+{
+	BakedHeader header;
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.internalFormat = internalFormat;
+	header.width = width;
+	header.height = height;
+	header.levels = levels;
+	header.mipMode = (uint32_t)mips;
+	header.keyLow = key.low;
+	header.keyHigh = key.high;
+
+	std::vector<BakedLevel> table(levels);
+	uint64_t offset = 0;
+	for (int i = 0; i < levels; i++)
+	{
+		table[i].offset = offset;
+		table[i].size = Texture::imageSize(Texture::levelDimension(width, i), Texture::levelDimension(height, i), internalFormat);
+		offset = alignUp(offset + table[i].size, LEVEL_ALIGNMENT);
+	}
+	header.dataSize = offset;
+
+	// write to a private temporary name and rename, so readers never map a half-written entry
+	std::string path = pathFor(key);
+	std::ostringstream temp;
+	temp << path << "." << std::this_thread::get_id() << ".tmp";
+	{
+		std::ofstream out(temp.str().c_str(), std::ios::binary | std::ios::trunc);
+		if (!out)
+		{
+			std::cout << "ERROR::TEXTURE_CACHE::FAILED_TO_WRITE " << temp.str() << std::endl;
+			return false;
+		}
+		const char zeros[LEVEL_ALIGNMENT] = {};
+		size_t tableEnd = sizeof(BakedHeader) + table.size() * sizeof(BakedLevel);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)table.data(), table.size() * sizeof(BakedLevel));
+		out.write(zeros, alignUp(tableEnd, LEVEL_ALIGNMENT) - tableEnd);
+
+		const unsigned char* level = chain;
+		for (int i = 0; i < levels; i++)
+		{
+			out.write((const char*)level, table[i].size);
+			out.write(zeros, alignUp(table[i].size, LEVEL_ALIGNMENT) - table[i].size);
+			level += table[i].size;
+		}
+		if (!out)
+		{
+			out.close();
+			std::remove(temp.str().c_str());
+			return false;
+		}
+	}
+	std::remove(path.c_str());
+	if (std::rename(temp.str().c_str(), path.c_str()) != 0)
+	{
+		std::remove(temp.str().c_str());
+		return false;
+	}
+	return true;
+}
+
+size_t TextureCache::packedSize(const Entry& entry)
+{
+	size_t size = 0;
+	for (uint32_t i = 0; i < entry.header.levels; i++)
+		size += (size_t)entry.levelTable[i].size;
+	return size;
+}
+
+void TextureCache::copyLevels(const Entry& entry, unsigned char* dst)
+{
+	for (uint32_t i = 0; i < entry.header.levels; i++)
+	{
+		const BakedLevel& level = entry.levelTable[i];
+		memcpy(dst, entry.data + level.offset, (size_t)level.size);
+		dst += level.size;
+	}
+}
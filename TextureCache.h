@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "Texture.h"
+#include "MipGenerator.h"
+#include "BlockCompressor.h"
+
+// On-disk cache of GPU-ready textures. A baked entry holds the final internal
+// format and every level the texture uploads (the full chain for
+// MipMode::Precomputed), so a warm start maps the file and copies it straight
+// into the upload buffer without decoding the source image.
+//
+// File layout (little endian): BakedHeader, then `levels` BakedLevel records,
+// then the level data, each level starting on a LEVEL_ALIGNMENT boundary.
+class TextureCache
+{
+public:
+	static const uint32_t VERSION = 2;
+	static const size_t LEVEL_ALIGNMENT = 16;
+
+	struct BakedHeader
+	{
+		char magic[8];            // "GLTEXBK\0"
+		uint32_t version;
+		uint32_t internalFormat;  // GL enum, e.g. GL_RGBA8
+		uint32_t width, height;
+		uint32_t levels;
+		uint32_t mipMode;         // MipMode the data was built for
+		uint64_t keyLow, keyHigh; // cache key, guards against renamed or truncated files
+		uint64_t dataSize;        // bytes of level data following the level table
+	};
+
+	struct BakedLevel
+	{
+		uint64_t offset;          // from the start of the level data
+		uint64_t size;
+	};
+
+	// a mapped cache entry; level data stays valid while the entry is alive
+	struct Entry
+	{
+		MappedFile file;
+		BakedHeader header;
+		const BakedLevel* levelTable;
+		const unsigned char* data;
+	};
+
+	explicit TextureCache(const std::string& directory);
+
+	// key for an image: its content hash combined with every option that changes the baked bytes
+	static Hash128 key(const Hash128& sourceHash, GLenum internalFormat, MipMode mips, MipFilter filter,
+		CompressionQuality quality, bool flipped);
+	// map the entry for key; returns false when it is missing or doesn't validate
+	bool load(const Hash128& key, Entry& entry) const;
+	// write levels in internalFormat laid out back to back (Texture::chainSize) as a new entry
+	bool store(const Hash128& key, GLenum internalFormat, MipMode mips, int width, int height, int levels,
+		const unsigned char* chain) const;
+
+	// copy all levels of an entry into dst, packed back to back as Texture::uploadChain expects
+	static void copyLevels(const Entry& entry, unsigned char* dst);
+	static size_t packedSize(const Entry& entry);
+
+private:
+	std::string directory;
+
+	std::string pathFor(const Hash128& key) const;
+};
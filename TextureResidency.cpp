@@ -0,0 +1,274 @@
+#include "TextureResidency.h"
+
+TextureResidency::TextureResidency(TextureStreamer& streamer, size_t budget, EvictionPolicy policy)
+	: streamer(streamer), limit(budget), policy(policy), resident(0), frame(0), shared(0)
+{
+	streamer.setUploadCallback([this](const Texture& texture, UploadResult result, const Hash128& contentKey)
+	{
+		uploaded(texture, result, contentKey);
+	});
+	streamer.setDuplicateCheck([this](unsigned int texture, const Hash128& contentKey)
+	{
+		return isDuplicate(texture, contentKey);
+	});
+}
+
+int TextureResidency::load(const std::string& path, const TextureOptions& options)
+{
+	int handle;
+	if (freeHandles.empty())
+	{
+		handle = (int)entries.size();
+		entries.push_back(Entry());
+	}
+	else
+	{
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+
+	Entry& entry = entries[handle];
+	entry = Entry();
+	entry.path = path;
+	entry.options = options;
+	entry.internalFormat = options.internalFormat;
+	entry.mips = options.mips;
+	entry.lastUsed = frame;
+	entry.live = true;
+	entry.references = 1;
+	entry.sharedWith = -1;
+	request(handle);
+	return handle;
+}
+
+unsigned int TextureResidency::use(int handle)
+{
+	Entry& entry = entries[handle];
+	entry.lastUsed = frame;
+	if (entry.sharedWith >= 0)
+		return use(entry.sharedWith);
+	// a pinned shrunken copy stays: the full image would come back under another name
+	if ((entry.texture == 0 || (entry.reduced && !entry.pins)) && !entry.pending && !entry.failed)
+		request(handle);
+	return entry.texture;
+}
+
+void TextureResidency::update()
+{
+	frame++;
+	if (resident > limit)
+	{
+		// least recently used first; what the last frame drew is the working set and evicting it would only thrash
+		std::vector<int> candidates;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (entries[i].live && entries[i].texture && !entries[i].pins && entries[i].lastUsed + 1 < frame)
+				candidates.push_back((int)i);
+		}
+		std::sort(candidates.begin(), candidates.end(),
+			[this](int a, int b) { return entries[a].lastUsed < entries[b].lastUsed; });
+
+		for (size_t i = 0; i < candidates.size() && resident > limit; i++)
+		{
+			Entry& entry = entries[candidates[i]];
+			if (policy == EvictionPolicy::DropMips)
+			{
+				while (resident > limit && entry.levels > 1)
+					dropTopMip(entry);
+			}
+			if (resident > limit)
+				unload(entry);
+		}
+	}
+}
+
+void TextureResidency::release(int handle)
+{
+	Entry& entry = entries[handle];
+	if (!entry.live || --entry.references > 0)
+		return;
+	if (entry.sharedWith >= 0)
+	{
+		// the handle never had a texture of its own, only a reference to the one it shares
+		int owner = entry.sharedWith;
+		entry.sharedWith = -1;
+		entry.live = false;
+		freeHandles.push_back(handle);
+		release(owner);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(contentMutex);
+		std::unordered_map<int, Hash128>::iterator claim = claimed.find(handle);
+		if (claim != claimed.end())
+		{
+			byContent.erase(claim->second);
+			claimed.erase(claim);
+		}
+		// a request still in flight skips decoding and is deleted when it arrives
+		if (entry.pending)
+			byPending[entry.pending] = -1;
+	}
+	unload(entry);
+	entry.live = false;
+	freeHandles.push_back(handle);
+}
+
+void TextureResidency::pin(int handle)
+{
+	Entry& entry = entries[handle];
+	if (entry.sharedWith >= 0)
+		pin(entry.sharedWith);
+	else
+		entry.pins++;
+}
+
+void TextureResidency::unpin(int handle)
+{
+	Entry& entry = entries[handle];
+	if (entry.sharedWith >= 0)
+		unpin(entry.sharedWith);
+	else if (entry.pins > 0)
+		entry.pins--;
+}
+
+void TextureResidency::dispose()
+{
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		entries[i].references = 1;
+		release((int)i);
+	}
+}
+
+void TextureResidency::request(int handle)
+{
+	Entry& entry = entries[handle];
+	// held across the request so its decode job can't run the duplicate check before the name is mapped
+	std::lock_guard<std::mutex> lock(contentMutex);
+	entry.pending = streamer.request(entry.path, entry.options);
+	byPending[entry.pending] = handle;
+}
+
+bool TextureResidency::isDuplicate(unsigned int texture, const Hash128& contentKey)
+{
+	std::lock_guard<std::mutex> lock(contentMutex);
+	std::unordered_map<unsigned int, int>::iterator request = byPending.find(texture);
+	if (request == byPending.end())
+		return false;
+	int handle = request->second;
+	if (handle < 0)
+		return true;  // released while queued, not worth decoding
+
+	std::unordered_map<Hash128, int, Hash128Hasher>::iterator owner = byContent.find(contentKey);
+	if (owner != byContent.end())
+		return owner->second != handle;
+	// the file changed under a reloading texture: it no longer stands for its old contents
+	std::unordered_map<int, Hash128>::iterator claim = claimed.find(handle);
+	if (claim != claimed.end())
+		byContent.erase(claim->second);
+	byContent[contentKey] = handle;
+	claimed[handle] = contentKey;
+	return false;
+}
+
+void TextureResidency::uploaded(const Texture& texture, UploadResult result, const Hash128& contentKey)
+{
+	int handle, owner = -1;
+	{
+		std::lock_guard<std::mutex> lock(contentMutex);
+		std::unordered_map<unsigned int, int>::iterator found = byPending.find(texture.ID);
+		if (found == byPending.end())
+			return;
+		handle = found->second;
+		byPending.erase(found);
+		if (result == UploadResult::Duplicate)
+		{
+			std::unordered_map<Hash128, int, Hash128Hasher>::iterator claim = byContent.find(contentKey);
+			if (claim != byContent.end())
+				owner = claim->second;
+		}
+	}
+
+	if (handle < 0 || entries[handle].pending != texture.ID || result != UploadResult::Loaded)
+	{
+		GLState::textureDeleted(texture.ID);
+		glDeleteTextures(1, &texture.ID);
+		if (handle < 0 || entries[handle].pending != texture.ID)
+			return;
+		Entry& entry = entries[handle];
+		entry.pending = 0;
+		if (result == UploadResult::Failed)
+			entry.failed = true;
+		else if (owner >= 0 && owner != handle)
+		{
+			// another handle claimed these contents first: share its texture
+			entry.sharedWith = owner;
+			entries[owner].references++;
+			shared++;
+		}
+		else
+		{
+			// the owner was released before this got here, load it after all
+			request(handle);
+		}
+		return;
+	}
+
+	Entry& entry = entries[handle];
+	if (entry.pins && entry.texture)
+	{
+		// requested before the pin: the pinned texture stays
+		GLState::textureDeleted(texture.ID);
+		glDeleteTextures(1, &texture.ID);
+		entry.pending = 0;
+		return;
+	}
+	// the full image replaces a shrunken copy
+	unload(entry);
+	entry.texture = texture.ID;
+	entry.pending = 0;
+	entry.width = texture.width;
+	entry.height = texture.height;
+	entry.levels = texture.levels;
+	entry.internalFormat = texture.internalFormat;
+	entry.mips = texture.mips;
+	entry.bytes = texture.byteSize();
+	entry.reduced = false;
+	resident += entry.bytes;
+}
+
+void TextureResidency::unload(Entry& entry)
+{
+	if (!entry.texture)
+		return;
+	GLState::textureDeleted(entry.texture);
+	glDeleteTextures(1, &entry.texture);
+	entry.texture = 0;
+	resident -= entry.bytes;
+	entry.bytes = 0;
+	entry.reduced = false;
+}
+
+void TextureResidency::dropTopMip(Entry& entry)
+{
+	Texture smaller;
+	smaller.allocate(Texture::levelDimension(entry.width, 1), Texture::levelDimension(entry.height, 1),
+		entry.internalFormat, entry.mips, entry.levels - 1);
+	for (int level = 0; level < smaller.levels; level++)
+	{
+		glCopyImageSubData(entry.texture, GL_TEXTURE_2D, level + 1, 0, 0, 0, smaller.ID, GL_TEXTURE_2D, level, 0, 0, 0,
+			Texture::levelDimension(smaller.width, level), Texture::levelDimension(smaller.height, level), 1);
+	}
+
+	GLState::textureDeleted(entry.texture);
+	glDeleteTextures(1, &entry.texture);
+	resident -= entry.bytes;
+	entry.texture = smaller.ID;
+	entry.width = smaller.width;
+	entry.height = smaller.height;
+	entry.levels = smaller.levels;
+	entry.bytes = smaller.byteSize();
+	entry.reduced = true;
+	resident += entry.bytes;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <mutex>
+#include <iostream>
+
+#include "Texture.h"
+#include "TextureStreamer.h"
+#include "TextureCache.h"
+#include "ContentHash.h"
+
+// what TextureResidency does with a texture that has to give up its memory
+enum class EvictionPolicy
+{
+	Unload,   // delete the texture; it streams back in on the next use()
+	DropMips  // first shrink it to its next smaller mip (a quarter of the memory), unload once only one level is left
+};
+
+// Keeps the textures it streams in under a GPU memory budget. Textures are
+// addressed by a stable handle because eviction and reloading replace the GL
+// texture behind it. Every use() stamps the texture with the current frame;
+// when update() finds the resident bytes over budget it evicts the textures
+// used longest ago, never one the previous frame used. An evicted texture
+// is requested again from the TextureStreamer the next time it is used, and
+// a shrunken one keeps being served until its full size has streamed back.
+// A pinned texture keeps its GL name: it is neither evicted nor replaced,
+// which is what anything holding on to the name, like a bindless handle in a
+// TextureTable, needs.
+//
+// Textures are shared by content: the streamer hashes the file bytes on its
+// decode thread and asks the duplicate check before decoding anything. The
+// first load of some contents (same bytes, same options) claims them, even
+// while it is still in flight; a later identical load is dropped right there,
+// without decoding, ring space or storage, and its handle shares the first
+// one's texture, holding one more reference to it. Only the last release()
+// of a texture deletes it.
+class TextureResidency
+{
+public:
+	// installs itself as the streamer's upload callback
+	TextureResidency(TextureStreamer& streamer, size_t budget, EvictionPolicy policy = EvictionPolicy::Unload);
+
+	// start streaming path in; returns the handle for use()
+	int load(const std::string& path, const TextureOptions& options = TextureOptions());
+	// mark the texture as used this frame and return its GL name, 0 while it is (re)loading
+	unsigned int use(int handle);
+	// call once per frame after TextureStreamer::update: evicts until the budget is met
+	void update();
+	// drop one reference; the last one deletes the texture and frees the handle
+	void release(int handle);
+	// keep the texture use() returns now from being evicted or replaced until a matching unpin();
+	// pin once use() returns the texture, and unpin before releasing it
+	void pin(int handle);
+	void unpin(int handle);
+
+	size_t residentBytes() const { return resident; }
+	// loads that turned out to duplicate a live texture and share it
+	size_t sharedLoads() const { return shared; }
+	size_t budget() const { return limit; }
+	void setBudget(size_t budget) { limit = budget; }
+	void dispose();
+
+private:
+	struct Entry
+	{
+		std::string path;
+		TextureOptions options;
+		unsigned int texture;  // what use() returns, 0 when nothing is resident
+		unsigned int pending;  // streamer request in flight, 0 if none
+		int width, height, levels;
+		GLenum internalFormat;
+		MipMode mips;
+		size_t bytes;          // memory held by texture
+		uint64_t lastUsed;     // frame of the last use()
+		bool reduced;          // texture is a shrunken copy of the full image
+		bool failed;           // the source couldn't be decoded, don't keep retrying
+		bool live;             // handle is allocated
+		int references;
+		int pins;              // pin() calls not matched by unpin() yet
+		int sharedWith;        // handle whose texture this one uses after loading a duplicate, -1 if none
+	};
+
+	TextureStreamer& streamer;
+	size_t limit;
+	EvictionPolicy policy;
+	size_t resident;
+	uint64_t frame;
+	size_t shared;
+	std::vector<Entry> entries;
+	std::vector<int> freeHandles;
+	// the maps below are read by the duplicate check on decode threads
+	std::mutex contentMutex;
+	std::unordered_map<unsigned int, int> byPending;  // requested texture name to handle, -1 once released
+	std::unordered_map<Hash128, int, Hash128Hasher> byContent;  // contents to the handle that claimed them
+	std::unordered_map<int, Hash128> claimed;        // handle to the contents it claimed
+
+	void request(int handle);
+	// duplicate check, on a decode thread: claims unclaimed contents for the request's handle
+	bool isDuplicate(unsigned int texture, const Hash128& contentKey);
+	void uploaded(const Texture& texture, UploadResult result, const Hash128& contentKey);
+	void unload(Entry& entry);
+	// replace the texture by a copy of its levels 1..n-1
+	void dropTopMip(Entry& entry);
+};
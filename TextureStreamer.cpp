@@ -0,0 +1,454 @@
+#include "TextureStreamer.h"
+#include "stb_image.h"
+
+// PBO offsets passed to glTextureSubImage2D must be aligned to the texel size; 256 also suits most drivers' DMA
+static const size_t RING_ALIGNMENT = 256;
+
+TextureStreamer::TextureStreamer(size_t ringSize, unsigned int decodeThreads, const char* cacheDirectory)
+	: pbo(0), mapped(NULL), ringSize(ringSize), head(0), used(0), flipVertically(false), jobs(NULL), inFlight(0),
+	stopping(false)
+{
+	init(cacheDirectory);
+	if (decodeThreads == 0)
+		decodeThreads = 1;
+	for (unsigned int i = 0; i < decodeThreads; i++)
+		workers.emplace_back(&TextureStreamer::decodeLoop, this);
+}
+
+TextureStreamer::TextureStreamer(JobSystem& jobs, size_t ringSize, const char* cacheDirectory)
+	: pbo(0), mapped(NULL), ringSize(ringSize), head(0), used(0), flipVertically(false), jobs(&jobs), inFlight(0),
+	stopping(false)
+{
+	init(cacheDirectory);
+}
+
+void TextureStreamer::init(const char* cacheDirectory)
+{
+	if (cacheDirectory)
+		cache.reset(new TextureCache(cacheDirectory));
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &pbo);
+	glNamedBufferStorage(pbo, ringSize, NULL, flags);
+	mapped = (unsigned char*)glMapNamedBufferRange(pbo, 0, ringSize, flags);
+	if (!mapped)
+		std::cout << "ERROR::TEXTURE_STREAMER::MAP_FAILED" << std::endl;
+}
+
+unsigned int TextureStreamer::request(const std::string& path, const TextureOptions& options)
+{
+	Texture texture;
+	Request job = { path, texture, options, options.internalFormat, false };
+	if (options.compression != BlockFormat::None)
+	{
+		bool srgb = options.internalFormat == GL_SRGB8_ALPHA8;
+		if (BlockCompressor::isSupported(options.compression, srgb))
+		{
+			job.internalFormat = BlockCompressor::glFormat(options.compression, srgb);
+			// glGenerateMipmap can't write compressed levels, build them on the CPU instead
+			if (options.mips == MipMode::Gpu)
+				job.options.mips = MipMode::Precomputed;
+		}
+		else
+		{
+			std::cout << "WARNING::TEXTURE_STREAMER::" << BlockCompressor::name(options.compression)
+				<< "_NOT_SUPPORTED, loading " << path << " uncompressed" << std::endl;
+			job.options.compression = BlockFormat::None;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job.flip = flipVertically;
+		requests.push_back(job);
+		inFlight++;
+	}
+	if (jobs)
+		jobs->run([this] { decodeNext(); }, &decodes);
+	else
+		requestReady.notify_one();
+	return texture.ID;
+}
+
+void TextureStreamer::decodeLoop()
+{
+	for (;;)
+	{
+		std::unique_lock<std::mutex> waitLock(mutex);
+		requestReady.wait(waitLock, [this] { return stopping || !requests.empty(); });
+		if (stopping)
+			return;
+		// copy the request rather than default-constructing one: Texture() needs the GL context
+		Decoded result = { requests.front(), 0, 0, 0, 0, NULL, false, false, { 0, 0 } };
+		requests.pop_front();
+		waitLock.unlock();
+		if (!decode(result))
+			return;
+	}
+}
+
+void TextureStreamer::decodeNext()
+{
+	std::unique_lock<std::mutex> waitLock(mutex);
+	// every request queues one job, so there is a request unless dispose() got here first
+	if (stopping || requests.empty())
+		return;
+	Decoded result = { requests.front(), 0, 0, 0, 0, NULL, false, false, { 0, 0 } };
+	requests.pop_front();
+	waitLock.unlock();
+	decode(result);
+}
+
+bool TextureStreamer::decode(Decoded& result)
+{
+	const Request& job = result.request;
+
+	MappedFile source;
+	if (!source.open(job.path))
+	{
+		result.failed = true;
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(result);
+		return true;
+	}
+
+	// hashed here rather than by the caller so the GL thread never reads the file; the upload callback gets it too
+	result.contentKey = TextureCache::key(hashBytes(source.data, source.size), job.internalFormat, job.options.mips,
+		job.options.mipFilter, job.options.quality, job.flip);
+	if (duplicateCheck && duplicateCheck(job.texture.ID, result.contentKey))
+	{
+		result.duplicate = true;
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(result);
+		return true;
+	}
+
+	// warm start: a baked entry for these exact bytes is copied into the ring without decoding
+	if (cache)
+	{
+		TextureCache::Entry entry;
+		if (cache->load(result.contentKey, entry))
+		{
+			result.width = entry.header.width;
+			result.height = entry.header.height;
+			result.size = TextureCache::packedSize(entry);
+			return deliver(result, [&](unsigned char* dst) { TextureCache::copyLevels(entry, dst); });
+		}
+	}
+
+	int channels;
+	stbi_set_flip_vertically_on_load_thread(job.flip);
+	// always expand to RGBA so rows stay 4-byte aligned and offsets stay texel aligned
+	unsigned char* data = stbi_load_from_memory(source.data, (int)source.size, &result.width, &result.height, &channels, 4);
+	source.close();
+	if (!data)
+	{
+		result.failed = true;
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(result);
+		return true;
+	}
+
+	int levels = levelCount(job, result.width, result.height);
+	result.size = Texture::chainSize(result.width, result.height, levels, job.internalFormat);
+	if (cache)
+	{
+		// cold start: build the levels in client memory once, bake them, then copy them into the ring
+		std::vector<unsigned char> chain(result.size);
+		writeLevels(result, data, chain.data(), jobs);
+		stbi_image_free(data);
+		cache->store(result.contentKey, job.internalFormat, job.options.mips, result.width, result.height, levels, chain.data());
+		return deliver(result, [&](unsigned char* dst) { memcpy(dst, chain.data(), result.size); });
+	}
+	bool delivered = deliver(result, [&](unsigned char* dst) { writeLevels(result, data, dst, jobs); });
+	stbi_image_free(data);
+	return delivered;
+}
+
+bool TextureStreamer::deliver(Decoded& result, const std::function<void(unsigned char*)>& write)
+{
+	bool inRing = mapped && result.size <= ringSize;
+	if (inRing)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (jobs)
+		{
+			// never wait as a job: JobSystem::wait() on the GL thread may run this one, and only that thread frees space
+			if (stopping)
+				return false;
+			inRing = allocate(result.size, result.offset);
+		}
+		else
+		{
+			spaceFreed.wait(lock, [&] { return stopping || allocate(result.size, result.offset); });
+			if (stopping)
+				return false;
+		}
+	}
+
+	if (inRing)
+	{
+		// the ring region is ours until update() uploads it, so fill it without holding the lock
+		write(mapped + result.offset);
+	}
+	else
+	{
+		result.fallback = new std::vector<unsigned char>(result.size);
+		write(result.fallback->data());
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	decoded.push_back(result);
+	return true;
+}
+
+int TextureStreamer::levelCount(const Request& job, int width, int height)
+{
+	return job.options.mips == MipMode::Precomputed ? Texture::mipLevels(width, height) : 1;
+}
+
+void TextureStreamer::writeLevels(const Decoded& image, const unsigned char* pixels, unsigned char* dst, JobSystem* jobs)
+{
+	const Request& job = image.request;
+	const TextureOptions& options = job.options;
+	int levels = levelCount(job, image.width, image.height);
+	bool srgb = options.internalFormat == GL_SRGB8_ALPHA8;
+
+	if (options.compression == BlockFormat::None)
+	{
+		if (levels > 1)
+			MipGenerator::build(pixels, image.width, image.height, levels, dst, options.mipFilter, srgb);
+		else
+			memcpy(dst, pixels, image.size);
+		return;
+	}
+
+	// the encoder reads its input many times, so CPU-built levels go to client memory rather than the ring
+	std::vector<unsigned char> chain;
+	const unsigned char* level = pixels;
+	if (levels > 1)
+	{
+		chain.resize(Texture::chainSize(image.width, image.height, levels));
+		MipGenerator::build(pixels, image.width, image.height, levels, chain.data(), options.mipFilter, srgb);
+		level = chain.data();
+	}
+
+	for (int i = 0; i < levels; i++)
+	{
+		int w = Texture::levelDimension(image.width, i), h = Texture::levelDimension(image.height, i);
+		size_t size = BlockCompressor::compressedSize(w, h, options.compression);
+		if (i == 0 && options.reportQuality)
+		{
+			// measure from a client copy, reading back write-combined ring memory is very slow
+			std::vector<unsigned char> blocks(size);
+			BlockCompressor::compress(level, w, h, options.compression, options.quality, blocks.data(), jobs);
+			std::cout << job.path << ": " << BlockCompressor::name(options.compression) << " "
+				<< (Texture::chainSize(image.width, image.height, levels, job.internalFormat) / 1024) << " KB, PSNR "
+				<< BlockCompressor::psnr(level, w, h, options.compression, blocks.data()) << " dB" << std::endl;
+			memcpy(dst, blocks.data(), size);
+		}
+		else
+		{
+			BlockCompressor::compress(level, w, h, options.compression, options.quality, dst, jobs);
+		}
+		level += (size_t)w * h * 4;
+		dst += size;
+	}
+}
+
+bool TextureStreamer::allocate(size_t size, size_t& offset)
+{
+	size = (size + RING_ALIGNMENT - 1) & ~(RING_ALIGNMENT - 1);
+	size_t tail = (head + ringSize - used) % ringSize;
+	size_t skipped = 0;
+
+	if (used == 0)
+	{
+		head = 0;
+		tail = 0;
+	}
+	if (used == 0 || head > tail)
+	{
+		// free space is [head, ringSize) plus [0, tail)
+		if (ringSize - head < size)
+		{
+			if (tail < size)
+				return false;
+			skipped = ringSize - head;
+			head = 0;
+		}
+	}
+	else if (tail - head < size)
+	{
+		return false;
+	}
+
+	offset = head;
+	head = (head + size) % ringSize;
+	used += skipped + size;
+	allocations.push_back({ offset, skipped + size, NULL, false });
+	return true;
+}
+
+void TextureStreamer::update(size_t uploadBudget)
+{
+	retire();
+
+	std::deque<Decoded> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t bytes = 0;
+		while (!decoded.empty() && bytes < uploadBudget)
+		{
+			Decoded& next = decoded.front();
+			bytes += next.size;
+			ready.push_back(next);
+			decoded.pop_front();
+		}
+	}
+	if (ready.empty())
+		return;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (size_t i = 0; i < ready.size(); i++)
+	{
+		Decoded& image = ready[i];
+		if (image.failed)
+		{
+			std::cout << "Failed to load texture " << image.request.path << std::endl;
+			if (uploadCallback)
+				uploadCallback(image.request.texture, UploadResult::Failed, image.contentKey);
+			continue;
+		}
+		if (image.duplicate)
+		{
+			if (uploadCallback)
+				uploadCallback(image.request.texture, UploadResult::Duplicate, image.contentKey);
+			continue;
+		}
+
+		Texture& texture = image.request.texture;
+		texture.allocate(image.width, image.height, image.request.internalFormat, image.request.options.mips);
+		if (image.fallback)
+		{
+			upload(texture, image.fallback->data());
+			delete image.fallback;
+		}
+		else
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+			upload(texture, (void*)image.offset);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+			GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t a = 0; a < allocations.size(); a++)
+			{
+				if (allocations[a].offset == image.offset && !allocations[a].uploaded)
+				{
+					allocations[a].fence = fence;
+					allocations[a].uploaded = true;
+					break;
+				}
+			}
+		}
+		if (texture.mips == MipMode::Gpu)
+			texture.generateMipmaps();
+		if (uploadCallback)
+			uploadCallback(texture, UploadResult::Loaded, image.contentKey);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	inFlight -= ready.size();
+}
+
+void TextureStreamer::upload(const Texture& texture, const void* pixels)
+{
+	if (texture.mips == MipMode::Precomputed)
+		texture.uploadChain(pixels);
+	else
+		texture.upload(0, pixels);
+}
+
+void TextureStreamer::retire()
+{
+	bool freed = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!allocations.empty() && allocations.front().uploaded)
+		{
+			Allocation& front = allocations.front();
+			// poll only, never wait: the ring just stays full a little longer
+			GLenum status = glClientWaitSync(front.fence, 0, 0);
+			if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+				break;
+			glDeleteSync(front.fence);
+			used -= front.consumed;
+			allocations.pop_front();
+			freed = true;
+		}
+	}
+	if (freed)
+		spaceFreed.notify_all();
+}
+
+void TextureStreamer::setFlipVertically(bool flip)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	flipVertically = flip;
+}
+
+bool TextureStreamer::flipsVertically()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return flipVertically;
+}
+
+void TextureStreamer::setUploadCallback(const UploadCallback& callback)
+{
+	uploadCallback = callback;
+}
+
+void TextureStreamer::setDuplicateCheck(const DuplicateCheck& check)
+{
+	duplicateCheck = check;
+}
+
+size_t TextureStreamer::pending()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return inFlight;
+}
+
+void TextureStreamer::dispose()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	requestReady.notify_all();
+	spaceFreed.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+	// jobs that start from here on return right away; the running ones finish their image
+	if (jobs)
+		jobs->wait(decodes);
+
+	for (size_t i = 0; i < decoded.size(); i++)
+		delete decoded[i].fallback;
+	decoded.clear();
+	for (size_t i = 0; i < allocations.size(); i++)
+	{
+		if (allocations[i].fence)
+			glDeleteSync(allocations[i].fence);
+	}
+	allocations.clear();
+
+	if (pbo)
+	{
+		glUnmapNamedBuffer(pbo);
+		glDeleteBuffers(1, &pbo);
+		pbo = 0;
+		mapped = NULL;
+	}
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <functional>
+#include <memory>
+
+#include "Texture.h"
+#include "MipGenerator.h"
+#include "TextureCache.h"
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+
+// how a streamed texture is stored on the GPU
+struct TextureOptions
+{
+	GLenum internalFormat = GL_RGBA8;  // GL_RGBA8 or GL_SRGB8_ALPHA8; sRGB also selects the sRGB compressed variant
+	MipMode mips = MipMode::None;
+	MipFilter mipFilter = MipFilter::Box;
+	BlockFormat compression = BlockFormat::None;
+	CompressionQuality quality = CompressionQuality::Normal;
+	bool reportQuality = false;        // print the PSNR of compressed level 0
+};
+
+// how a streamed request finished
+enum class UploadResult
+{
+	Loaded,
+	Failed,    // the file couldn't be read or decoded
+	Duplicate  // the duplicate check claimed it: nothing was decoded and the texture has no storage
+};
+
+// Loads textures without stalling the render loop. Decode threads run stbi_load
+// (and build the mip chain for MipMode::Precomputed, and block compress) and write the pixels
+// straight into a ring of persistently mapped pixel unpack buffer memory; the
+// GL thread only issues glTextureSubImage2D from the PBO in update() and fences
+// each upload so the ring space can be reused once the driver has consumed it.
+// With a cache directory, decoded levels are baked to disk on first load and
+// later loads of the same file contents skip decoding entirely.
+//
+// Given a JobSystem, every request becomes a decode job on its workers instead
+// of the streamer's own threads. Jobs never wait for ring space: when the ring
+// is full the image is uploaded from client memory, as oversized ones are.
+class TextureStreamer
+{
+public:
+	TextureStreamer(size_t ringSize = 64 * 1024 * 1024, unsigned int decodeThreads = 2, const char* cacheDirectory = NULL);
+	TextureStreamer(JobSystem& jobs, size_t ringSize = 64 * 1024 * 1024, const char* cacheDirectory = NULL);
+	// queue an image for loading; returns the texture name right away, it gets storage and pixels once streamed in
+	unsigned int request(const std::string& path, const TextureOptions& options = TextureOptions());
+	// call once per frame on the GL thread: uploads decoded images (up to uploadBudget bytes) and recycles ring space
+	void update(size_t uploadBudget = 16 * 1024 * 1024);
+	// flip images loaded by later requests, like stbi_set_flip_vertically_on_load (baked entries are keyed on it)
+	void setFlipVertically(bool flip);
+	bool flipsVertically();
+	// called on the GL thread from update() for every finished request. contentKey is the bake key of the
+	// file contents and the resolved options: requests that produce identical textures get equal keys
+	typedef std::function<void(const Texture& texture, UploadResult result, const Hash128& contentKey)> UploadCallback;
+	void setUploadCallback(const UploadCallback& callback);
+	// called on a decode thread as soon as a request's file is hashed, before anything is decoded or
+	// uploaded; returning true drops the request, which then finishes as UploadResult::Duplicate
+	typedef std::function<bool(unsigned int texture, const Hash128& contentKey)> DuplicateCheck;
+	void setDuplicateCheck(const DuplicateCheck& check);
+	// number of requests that have not been uploaded yet
+	size_t pending();
+	void dispose();
+
+private:
+	struct Request
+	{
+		std::string path;
+		Texture texture;
+		TextureOptions options;
+		GLenum internalFormat;  // resolved GL format, compressed if options.compression is set
+		bool flip;
+	};
+
+	struct Decoded
+	{
+		Request request;
+		int width, height;
+		size_t size;                          // bytes to upload, including CPU-built levels
+		size_t offset;                        // offset into the ring
+		std::vector<unsigned char>* fallback; // data larger than the ring, uploaded from client memory
+		bool failed;
+		bool duplicate;                       // dropped by the duplicate check before decoding
+		Hash128 contentKey;                   // TextureCache::key of the source bytes, hashed once while decoding
+	};
+
+	// a ring allocation, kept in allocation order so space is released in the same order
+	struct Allocation
+	{
+		size_t offset;
+		size_t consumed;  // size plus any bytes skipped at the end of the ring before it
+		GLsync fence;
+		bool uploaded;
+	};
+
+	unsigned int pbo;
+	unsigned char* mapped;
+	size_t ringSize;
+	size_t head, used;
+	std::unique_ptr<TextureCache> cache;
+	bool flipVertically;
+	UploadCallback uploadCallback;
+	DuplicateCheck duplicateCheck;
+
+	std::vector<std::thread> workers;
+	JobSystem* jobs;
+	JobCounter decodes;  // decode jobs not finished yet
+	std::mutex mutex;
+	std::condition_variable requestReady;
+	std::condition_variable spaceFreed;
+	std::deque<Request> requests;
+	std::deque<Decoded> decoded;
+	std::deque<Allocation> allocations;
+	size_t inFlight;
+	bool stopping;
+
+	void init(const char* cacheDirectory);
+	void decodeLoop();
+	// decode job: pops one request and decodes it
+	void decodeNext();
+	// decode one request and queue it for upload; returns false if the streamer is shutting down
+	bool decode(Decoded& result);
+	// place size bytes produced by write into the ring (or client memory) and queue them for upload;
+	// returns false if the streamer is shutting down. Waits for ring space unless running as a job
+	bool deliver(Decoded& result, const std::function<void(unsigned char*)>& write);
+	// write level 0, or the whole CPU-built chain, of a decoded image to dst, block compressed if requested;
+	// jobs (optional) encodes the blocks in parallel
+	static void writeLevels(const Decoded& image, const unsigned char* pixels, unsigned char* dst, JobSystem* jobs);
+	static int levelCount(const Request& job, int width, int height);
+	// upload from client memory or, with the PBO bound, from a ring offset
+	static void upload(const Texture& texture, const void* pixels);
+	// reserve ring space (mutex held); returns false when it does not fit right now
+	bool allocate(size_t size, size_t& offset);
+	// release ring space of uploads the GPU has finished reading
+	void retire();
+};
@@ -0,0 +1,164 @@
+#include "TextureTable.h"
+
+// GL_ARB_bindless_texture entry points; the GLAD loader in this project is generated without extensions
+typedef GLuint64(APIENTRYP GetTextureHandleProc)(GLuint texture);
+typedef void (APIENTRYP MakeTextureHandleResidentProc)(GLuint64 handle);
+typedef void (APIENTRYP MakeTextureHandleNonResidentProc)(GLuint64 handle);
+
+static GetTextureHandleProc getTextureHandle = NULL;
+static MakeTextureHandleResidentProc makeTextureHandleResident = NULL;
+static MakeTextureHandleNonResidentProc makeTextureHandleNonResident = NULL;
+
+TextureTable::TextureTable(int layerWidth, int layerHeight, int capacity, MipMode mips, GLenum internalFormat,
+	GLADloadproc loader)
+	: mode(TextureBackend::Array), capacity(capacity), arrayID(0), layerWidth(layerWidth), layerHeight(layerHeight),
+	levels(1), internalFormat(internalFormat), readFramebuffer(0), drawFramebuffer(0), handleBuffer(0),
+	used(capacity, false)
+{
+	for (int i = capacity - 1; i >= 0; i--)
+		freeIndices.push_back(i);
+
+	if (loader && loadBindless(loader))
+	{
+		mode = TextureBackend::Bindless;
+		handles.assign(capacity, 0);
+		glCreateBuffers(1, &handleBuffer);
+		glNamedBufferStorage(handleBuffer, capacity * sizeof(GLuint64), handles.data(), GL_DYNAMIC_STORAGE_BIT);
+		return;
+	}
+
+	levels = mips == MipMode::None ? 1 : Texture::mipLevels(layerWidth, layerHeight);
+	glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &arrayID);
+	glTextureStorage3D(arrayID, levels, internalFormat, layerWidth, layerHeight, capacity);
+	glTextureParameteri(arrayID, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(arrayID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(arrayID, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	glCreateFramebuffers(1, &readFramebuffer);
+	glCreateFramebuffers(1, &drawFramebuffer);
+}
+
+int TextureTable::add(unsigned int texture)
+{
+	// both backends need storage that is already allocated: handles freeze the texture, copies read level 0
+	GLint immutable = 0;
+	glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+	if (!immutable)
+	{
+		std::cout << "ERROR::TEXTURE_TABLE::TEXTURE_HAS_NO_STORAGE " << texture << std::endl;
+		return -1;
+	}
+
+	int index = allocateIndex();
+	if (index < 0)
+		return -1;
+
+	if (mode == TextureBackend::Bindless)
+	{
+		GLuint64 handle = getTextureHandle(texture);
+		makeTextureHandleResident(handle);
+		handles[index] = handle;
+		glNamedBufferSubData(handleBuffer, index * sizeof(GLuint64), sizeof(GLuint64), &handle);
+	}
+	else if (!copyToLayer(texture, index))
+	{
+		remove(index);
+		return -1;
+	}
+	return index;
+}
+
+void TextureTable::remove(int index)
+{
+	if (index < 0 || index >= capacity || !used[index])
+		return;
+	if (mode == TextureBackend::Bindless && handles[index])
+	{
+		makeTextureHandleNonResident(handles[index]);
+		handles[index] = 0;
+	}
+	used[index] = false;
+	freeIndices.push_back(index);
+}
+
+void TextureTable::bind(unsigned int unit, unsigned int storageBinding) const
+{
+	if (mode == TextureBackend::Bindless)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, storageBinding, handleBuffer);
+	}
+	else
+	{
+		GLState::bindTexture(unit, arrayID);
+	}
+}
+
+void TextureTable::dispose()
+{
+	for (int i = 0; i < capacity; i++)
+		remove(i);
+	glDeleteBuffers(1, &handleBuffer);
+	glDeleteFramebuffers(1, &readFramebuffer);
+	glDeleteFramebuffers(1, &drawFramebuffer);
+	GLState::textureDeleted(arrayID);
+	glDeleteTextures(1, &arrayID);
+	handleBuffer = readFramebuffer = drawFramebuffer = arrayID = 0;
+}
+
+int TextureTable::allocateIndex()
+{
+	if (freeIndices.empty())
+	{
+		std::cout << "ERROR::TEXTURE_TABLE::FULL capacity " << capacity << std::endl;
+		return -1;
+	}
+	int index = freeIndices.back();
+	freeIndices.pop_back();
+	used[index] = true;
+	return index;
+}
+
+bool TextureTable::copyToLayer(unsigned int texture, int layer)
+{
+	GLint width = 0, height = 0, format = 0;
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+	glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+
+	if (width == layerWidth && height == layerHeight && (GLenum)format == internalFormat)
+	{
+		// same size and format: a straight GPU copy, compressed blocks included
+		glCopyImageSubData(texture, GL_TEXTURE_2D, 0, 0, 0, 0, arrayID, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer,
+			width, height, 1);
+	}
+	else if (Texture::isCompressed((GLenum)format) || Texture::isCompressed(internalFormat))
+	{
+		std::cout << "ERROR::TEXTURE_TABLE::CANNOT_SCALE_COMPRESSED " << width << "x" << height << " into "
+			<< layerWidth << "x" << layerHeight << std::endl;
+		return false;
+	}
+	else
+	{
+		glNamedFramebufferTexture(readFramebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+		glNamedFramebufferTextureLayer(drawFramebuffer, GL_COLOR_ATTACHMENT0, arrayID, 0, layer);
+		glBlitNamedFramebuffer(readFramebuffer, drawFramebuffer, 0, 0, width, height, 0, 0, layerWidth, layerHeight,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+
+	if (levels > 1)
+	{
+		// rebuilds every layer; adds are rare compared to draws
+		glGenerateTextureMipmap(arrayID);
+	}
+	return true;
+}
+
+bool TextureTable::loadBindless(GLADloadproc loader)
+{
+	if (!Texture::hasExtension("GL_ARB_bindless_texture"))
+		return false;
+	getTextureHandle = (GetTextureHandleProc)loader("glGetTextureHandleARB");
+	makeTextureHandleResident = (MakeTextureHandleResidentProc)loader("glMakeTextureHandleResidentARB");
+	makeTextureHandleNonResident = (MakeTextureHandleNonResidentProc)loader("glMakeTextureHandleNonResidentARB");
+	return getTextureHandle && makeTextureHandleResident && makeTextureHandleNonResident;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "Texture.h"
+
+// how a TextureTable exposes its textures to shaders
+enum class TextureBackend
+{
+	Array,    // layers of one GL_TEXTURE_2D_ARRAY, sampled as sampler2DArray with the index as layer
+	Bindless  // GL_ARB_bindless_texture handles in an SSBO, sampled as sampler2D(handles[index])
+};
+
+// Gives textures a small integer index that shaders select them by, so
+// drawing with a different texture only changes a uniform or per-draw value
+// instead of a glBindTexture. The table is bound once with bind().
+//
+// With GL_ARB_bindless_texture every added texture is made resident and its
+// 64-bit handle is written to a shader storage buffer. Without it textures
+// are copied into the layers of one texture array; a layer has a fixed size,
+// so textures of another size are scaled into it with glBlitFramebuffer.
+class TextureTable
+{
+public:
+	// capacity is the number of indices; layerWidth x layerHeight is only used by the array backend.
+	// loader resolves the bindless entry points (pass glfwGetProcAddress); NULL forces the array backend.
+	TextureTable(int layerWidth, int layerHeight, int capacity, MipMode mips = MipMode::None,
+		GLenum internalFormat = GL_RGBA8, GLADloadproc loader = NULL);
+
+	// register a 2D texture with allocated storage; returns its index or -1 when the table is full.
+	// The bindless backend references the texture, so it has to outlive its entry (pin it if a TextureResidency
+	// owns it, eviction would delete it under the handle); the array backend copies it.
+	int add(unsigned int texture);
+	// free an index for reuse; bindless handles are made non-resident
+	void remove(int index);
+	// bind the array to a texture unit, or the handle buffer to a shader storage binding
+	void bind(unsigned int unit, unsigned int storageBinding) const;
+
+	TextureBackend backend() const { return mode; }
+	// GL name of the texture array (array backend only)
+	unsigned int arrayTexture() const { return arrayID; }
+	void dispose();
+
+private:
+	TextureBackend mode;
+	int capacity;
+	unsigned int arrayID;          // array backend storage
+	int layerWidth, layerHeight;
+	int levels;
+	GLenum internalFormat;
+	unsigned int readFramebuffer;  // for scaling textures into layers
+	unsigned int drawFramebuffer;
+	unsigned int handleBuffer;     // bindless backend SSBO of GLuint64 handles
+	std::vector<uint64_t> handles;
+	std::vector<int> freeIndices;
+	std::vector<bool> used;
+
+	int allocateIndex();
+	bool copyToLayer(unsigned int texture, int layer);
+	static bool loadBindless(GLADloadproc loader);
+};
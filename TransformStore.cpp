@@ -0,0 +1,209 @@
+#include "TransformStore.h"
+
+#include <cstring>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_STORE_SSE
+#include <xmmintrin.h>
+#endif
+
+// groups of four per job when update() runs on the job system; below this it stays on the calling thread
+static const size_t GROUPS_PER_JOB = 256;
+
+TransformStore::TransformStore(size_t capacity)
+	: count(0)
+{
+	size_t padded = (capacity + 3) / 4 * 4;
+	px.reserve(padded); py.reserve(padded); pz.reserve(padded);
+	qx.reserve(padded); qy.reserve(padded); qz.reserve(padded); qw.reserve(padded);
+	sx.reserve(padded); sy.reserve(padded); sz.reserve(padded);
+	dirty.reserve(padded);
+}
+
+unsigned int TransformStore::create(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+	if (count == px.size())
+		grow();
+	unsigned int index = (unsigned int)count++;
+	setPosition(index, position);
+	setRotation(index, rotation);
+	setScale(index, scale);
+	return index;
+}
+
+void TransformStore::grow()
+{
+	// four identity lanes at a time; their dirty flag stays clear so they are never written out
+	for (int i = 0; i < 4; i++)
+	{
+		px.push_back(0.0f); py.push_back(0.0f); pz.push_back(0.0f);
+		qx.push_back(0.0f); qy.push_back(0.0f); qz.push_back(0.0f); qw.push_back(1.0f);
+		sx.push_back(1.0f); sy.push_back(1.0f); sz.push_back(1.0f);
+		dirty.push_back(0);
+	}
+}
+
+void TransformStore::setPosition(unsigned int index, const glm::vec3& position)
+{
+	px[index] = position.x;
+	py[index] = position.y;
+	pz[index] = position.z;
+	dirty[index] = 1;
+}
+
+void TransformStore::setRotation(unsigned int index, const glm::quat& rotation)
+{
+	qx[index] = rotation.x;
+	qy[index] = rotation.y;
+	qz[index] = rotation.z;
+	qw[index] = rotation.w;
+	dirty[index] = 1;
+}
+
+void TransformStore::setScale(unsigned int index, const glm::vec3& scale)
+{
+	sx[index] = scale.x;
+	sy[index] = scale.y;
+	sz[index] = scale.z;
+	dirty[index] = 1;
+}
+
+glm::vec3 TransformStore::position(unsigned int index) const
+{
+	return glm::vec3(px[index], py[index], pz[index]);
+}
+
+glm::quat TransformStore::rotation(unsigned int index) const
+{
+	return glm::quat(qw[index], qx[index], qy[index], qz[index]);
+}
+
+glm::vec3 TransformStore::scale(unsigned int index) const
+{
+	return glm::vec3(sx[index], sy[index], sz[index]);
+}
+
+void TransformStore::markAllDirty()
+{
+	if (count)
+		memset(dirty.data(), 1, count);
+}
+
+size_t TransformStore::update(std::vector<glm::mat4>& destination, JobSystem* jobs)
+{
+	if (destination.size() < count)
+	{
+		destination.resize(count, glm::mat4(1.0f));
+		// the new entries hold nothing yet
+		markAllDirty();
+	}
+	return update((unsigned char*)destination.data(), sizeof(glm::mat4), jobs);
+}
+
+size_t TransformStore::update(unsigned char* destination, size_t stride, JobSystem* jobs)
+{
+	size_t groups = (count + 3) / 4;
+	if (!jobs || groups <= GROUPS_PER_JOB)
+		return updateGroups(0, groups, destination, stride);
+
+	// groups never share a flag or a destination record, so chunks run without locking
+	std::atomic<size_t> written(0);
+	jobs->parallelFor(groups, GROUPS_PER_JOB, [&](size_t begin, size_t end)
+	{
+		written.fetch_add(updateGroups(begin, end, destination, stride), std::memory_order_relaxed);
+	});
+	return written.load();
+}
+
+size_t TransformStore::updateGroups(size_t first, size_t last, unsigned char* destination, size_t stride)
+{
+	size_t written = 0;
+	for (size_t group = first; group < last; group++)
+	{
+		size_t base = group * 4;
+		uint32_t flags;
+		memcpy(&flags, &dirty[base], sizeof(flags));
+		if (!flags)
+			continue;
+
+		// columns of the four matrices; the tail group of a store is built here and copied out lane by lane
+		float matrices[4][16];
+#if defined(TRANSFORM_STORE_SSE)
+		__m128 x = _mm_loadu_ps(&qx[base]), y = _mm_loadu_ps(&qy[base]), z = _mm_loadu_ps(&qz[base]);
+		__m128 w = _mm_loadu_ps(&qw[base]);
+		__m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+		__m128 x2 = _mm_mul_ps(x, two), y2 = _mm_mul_ps(y, two), z2 = _mm_mul_ps(z, two);
+		__m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+		__m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+		__m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+		__m128 scaleX = _mm_loadu_ps(&sx[base]), scaleY = _mm_loadu_ps(&sy[base]), scaleZ = _mm_loadu_ps(&sz[base]);
+		// rows r of column c for all four transforms: rotation times the column's scale
+		__m128 columns[4][4];
+		columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), scaleX);
+		columns[0][1] = _mm_mul_ps(_mm_add_ps(xy, wz), scaleX);
+		columns[0][2] = _mm_mul_ps(_mm_sub_ps(xz, wy), scaleX);
+		columns[0][3] = _mm_setzero_ps();
+		columns[1][0] = _mm_mul_ps(_mm_sub_ps(xy, wz), scaleY);
+		columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), scaleY);
+		columns[1][2] = _mm_mul_ps(_mm_add_ps(yz, wx), scaleY);
+		columns[1][3] = _mm_setzero_ps();
+		columns[2][0] = _mm_mul_ps(_mm_add_ps(xz, wy), scaleZ);
+		columns[2][1] = _mm_mul_ps(_mm_sub_ps(yz, wx), scaleZ);
+		columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), scaleZ);
+		columns[2][3] = _mm_setzero_ps();
+		columns[3][0] = _mm_loadu_ps(&px[base]);
+		columns[3][1] = _mm_loadu_ps(&py[base]);
+		columns[3][2] = _mm_loadu_ps(&pz[base]);
+		columns[3][3] = one;
+
+		for (int c = 0; c < 4; c++)
+		{
+			// one register per row across the transforms -> one register per transform holding column c
+			_MM_TRANSPOSE4_PS(columns[c][0], columns[c][1], columns[c][2], columns[c][3]);
+			for (int lane = 0; lane < 4; lane++)
+				_mm_storeu_ps(&matrices[lane][c * 4], columns[c][lane]);
+		}
+#else
+		for (int lane = 0; lane < 4; lane++)
+		{
+			size_t i = base + lane;
+			float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+			float* m = matrices[lane];
+			m[0] = (1.0f - 2.0f * (y * y + z * z)) * sx[i];
+			m[1] = 2.0f * (x * y + w * z) * sx[i];
+			m[2] = 2.0f * (x * z - w * y) * sx[i];
+			m[3] = 0.0f;
+			m[4] = 2.0f * (x * y - w * z) * sy[i];
+			m[5] = (1.0f - 2.0f * (x * x + z * z)) * sy[i];
+			m[6] = 2.0f * (y * z + w * x) * sy[i];
+			m[7] = 0.0f;
+			m[8] = 2.0f * (x * z + w * y) * sz[i];
+			m[9] = 2.0f * (y * z - w * x) * sz[i];
+			m[10] = (1.0f - 2.0f * (x * x + y * y)) * sz[i];
+			m[11] = 0.0f;
+			m[12] = px[i];
+			m[13] = py[i];
+			m[14] = pz[i];
+			m[15] = 1.0f;
+		}
+#endif
+
+		// clean lanes of a dirty group are rewritten with the same values, which is cheaper than masking them
+		size_t lanes = count - base < 4 ? count - base : 4;
+		for (size_t lane = 0; lane < lanes; lane++)
+			memcpy(destination + (base + lane) * stride, matrices[lane], sizeof(matrices[lane]));
+		memset(&dirty[base], 0, 4);
+		written += lanes;
+	}
+	return written;
+}
+
+glm::mat4 TransformStore::compose(unsigned int index) const
+{
+	glm::mat4 matrix = glm::translate(glm::mat4(1.0f), position(index));
+	matrix = matrix * glm::mat4_cast(rotation(index));
+	return glm::scale(matrix, scale(index));
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "JobSystem.h"
+
+// Position, rotation and scale of many objects in structure-of-arrays layout:
+// every component (x positions, y positions, ..., quaternion w, ..., z scales)
+// is its own array, so update() loads four objects' worth of one component
+// per SSE instruction and builds four matrices at once, with no shuffling
+// until the final transpose into column-major glm::mat4.
+//
+// Setters only mark the transform dirty. update() rebuilds the matrices of
+// groups of four that contain a dirty transform and writes them to a
+// caller-owned destination with any stride: a std::vector<glm::mat4>, or the
+// transform field of QuadInstance records in mapped buffer memory. Clean
+// groups are skipped, so the destination must still hold the previous
+// results; anything else in the records is left untouched.
+class TransformStore
+{
+public:
+	explicit TransformStore(size_t capacity = 1024);
+
+	// add a transform; returns its index, which stays valid (transforms are never removed)
+	unsigned int create(const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+		const glm::vec3& scale = glm::vec3(1.0f));
+	size_t size() const { return count; }
+
+	void setPosition(unsigned int index, const glm::vec3& position);
+	// rotation must be normalized
+	void setRotation(unsigned int index, const glm::quat& rotation);
+	void setScale(unsigned int index, const glm::vec3& scale);
+	glm::vec3 position(unsigned int index) const;
+	glm::quat rotation(unsigned int index) const;
+	glm::vec3 scale(unsigned int index) const;
+	bool isDirty(unsigned int index) const { return dirty[index] != 0; }
+	// rewrite every matrix on the next update(), e.g. for a new destination
+	void markAllDirty();
+
+	// write translate * rotate * scale of dirty transforms to destination + index * stride, as a
+	// column-major glm::mat4, and clear their flags; jobs spreads large stores over the workers.
+	// Returns the number of matrices written
+	size_t update(unsigned char* destination, size_t stride, JobSystem* jobs = NULL);
+	size_t update(std::vector<glm::mat4>& destination, JobSystem* jobs = NULL);
+
+	// the matrix update() writes for one transform, built with glm (reference for the SIMD path)
+	glm::mat4 compose(unsigned int index) const;
+
+private:
+	size_t count;
+	// padded to a multiple of four with identity transforms so every group loads four lanes
+	std::vector<float> px, py, pz;
+	std::vector<float> qx, qy, qz, qw;
+	std::vector<float> sx, sy, sz;
+	std::vector<uint8_t> dirty;
+
+	void grow();
+	// build the matrices of groups [first, last) of four transforms
+	size_t updateGroups(size_t first, size_t last, unsigned char* destination, size_t stride);
+};
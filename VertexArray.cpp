@@ -0,0 +1,29 @@
+#include "VertexArray.h"
+
+VertexArray::VertexArray()
+	: ID(0)
+{
+	glCreateVertexArrays(1, &ID);
+}
+
+void VertexArray::setFormat(const VertexFormat& format, unsigned int binding)
+{
+	format.apply(ID, binding);
+}
+
+void VertexArray::setVertexBuffer(unsigned int binding, unsigned int buffer, size_t offset, size_t stride)
+{
+	glVertexArrayVertexBuffer(ID, binding, buffer, (GLintptr)offset, (GLsizei)stride);
+}
+
+void VertexArray::setIndexBuffer(unsigned int buffer)
+{
+	glVertexArrayElementBuffer(ID, buffer);
+}
+
+void VertexArray::dispose()
+{
+	GLState::vertexArrayDeleted(ID);
+	glDeleteVertexArrays(1, &ID);
+	ID = 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+#include "VertexFormat.h"
+#include "GLState.h"
+
+// Vertex array object set up through direct state access
+// (glCreateVertexArrays, glVertexArrayAttribFormat, glVertexArrayVertexBuffer):
+// formats and buffers are attached by name without binding the VAO, so a mesh
+// can be created while another one is bound for drawing.
+class VertexArray
+{
+public:
+	// the vertex array ID, bind it with glBindVertexArray to draw
+	unsigned int ID;
+
+	VertexArray();
+	// describe every attribute of format as reading from buffer binding point binding
+	void setFormat(const VertexFormat& format, unsigned int binding = 0);
+	// attach buffer to binding point binding; stride is the bytes between vertices
+	void setVertexBuffer(unsigned int binding, unsigned int buffer, size_t offset, size_t stride);
+	void setIndexBuffer(unsigned int buffer);
+	void dispose();
+};
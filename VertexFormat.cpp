@@ -0,0 +1,242 @@
+#include "VertexFormat.h"
+
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_FORMAT_SSE2
+#include <emmintrin.h>
+#if defined(__F16C__) || defined(__AVX2__)
+#define VERTEX_FORMAT_F16C
+#include <immintrin.h>
+#endif
+#endif
+
+VertexFormat::VertexFormat()
+	: bytes(0), floats(0)
+{
+}
+
+VertexFormat& VertexFormat::add(unsigned int location, int components, AttributeEncoding encoding)
+{
+	if (components < 1 || components > 4)
+	{
+		std::cout << "ERROR::VERTEX_FORMAT::BAD_COMPONENT_COUNT " << components << std::endl;
+		return *this;
+	}
+	Attribute attribute = { location, components, encoding, bytes };
+	layout.push_back(attribute);
+	// every attribute starts 4-byte aligned, which GL requires for the offsets and stride
+	bytes += (components * componentSize(encoding) + 3) / 4 * 4;
+	floats += components;
+	return *this;
+}
+
+void VertexFormat::apply(unsigned int vao, unsigned int binding) const
+{
+	for (size_t i = 0; i < layout.size(); i++)
+	{
+		const Attribute& a = layout[i];
+		GLboolean normalized = a.encoding == AttributeEncoding::UNorm8 || a.encoding == AttributeEncoding::UNorm16;
+		glVertexArrayAttribFormat(vao, a.location, a.components, glType(a.encoding), normalized, (GLuint)a.offset);
+		glVertexArrayAttribBinding(vao, a.location, binding);
+		glEnableVertexArrayAttrib(vao, a.location);
+	}
+}
+
+void VertexFormat::pack(const float* src, size_t vertexCount, unsigned char* dst) const
+{
+	// gather each attribute into a contiguous column so the converters run over long arrays,
+	// then scatter the encoded column into the interleaved vertices
+	std::vector<float> column;
+	std::vector<unsigned char> encoded;
+	size_t sourceOffset = 0;
+	for (size_t i = 0; i < layout.size(); i++)
+	{
+		const Attribute& a = layout[i];
+		size_t count = vertexCount * a.components;
+		size_t size = a.components * componentSize(a.encoding);
+		size_t slot = (size + 3) / 4 * 4;
+
+		column.resize(count);
+		for (size_t v = 0; v < vertexCount; v++)
+			for (int c = 0; c < a.components; c++)
+				column[v * a.components + c] = src[v * floats + sourceOffset + c];
+
+		encoded.resize(count * componentSize(a.encoding));
+		switch (a.encoding)
+		{
+		case AttributeEncoding::Float:
+			std::memcpy(encoded.data(), column.data(), count * sizeof(float));
+			break;
+		case AttributeEncoding::HalfFloat:
+			toHalf(column.data(), (uint16_t*)encoded.data(), count);
+			break;
+		case AttributeEncoding::UNorm8:
+			toUNorm8(column.data(), (uint8_t*)encoded.data(), count);
+			break;
+		case AttributeEncoding::UNorm16:
+			toUNorm16(column.data(), (uint16_t*)encoded.data(), count);
+			break;
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			unsigned char* out = dst + v * bytes + a.offset;
+			std::memcpy(out, encoded.data() + v * size, size);
+			// zero the alignment padding so the buffer contents are deterministic
+			if (slot > size)
+				std::memset(out + size, 0, slot - size);
+		}
+		sourceOffset += a.components;
+	}
+}
+
+uint16_t VertexFormat::toHalf(float value)
+{
+	// round to nearest even; overflow becomes infinity, NaN stays a quiet NaN
+	uint32_t x;
+	std::memcpy(&x, &value, sizeof(x));
+	uint32_t sign = x & 0x80000000u;
+	x ^= sign;
+	uint32_t half;
+	if (x >= 0x47800000u)
+		half = x > 0x7F800000u ? 0x7E00u : 0x7C00u;
+	else if (x < 0x38800000u)
+	{
+		// below the smallest normal half: adding 0.5 lines the mantissa up with the half denormal bits
+		float f;
+		std::memcpy(&f, &x, sizeof(f));
+		f += 0.5f;
+		std::memcpy(&half, &f, sizeof(half));
+		half -= 0x3F000000u;
+	}
+	else
+	{
+		uint32_t odd = (x >> 13) & 1;
+		x += ((uint32_t)(15 - 127) << 23) + 0xFFFu + odd;
+		half = x >> 13;
+	}
+	return (uint16_t)(half | (sign >> 16));
+}
+
+void VertexFormat::toHalf(const float* src, uint16_t* dst, size_t count)
+{
+	size_t i = 0;
+#if defined(VERTEX_FORMAT_F16C)
+	for (; i + 4 <= count; i += 4)
+		_mm_storel_epi64((__m128i*)(dst + i), _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#elif defined(VERTEX_FORMAT_SSE2)
+	// the scalar toHalf() four lanes at a time
+	const __m128i signMask = _mm_set1_epi32((int)0x80000000u);
+	const __m128i infinity = _mm_set1_epi32(0x7F800000);
+	const __m128i overflow = _mm_set1_epi32(0x477FFFFF);
+	const __m128i minNormal = _mm_set1_epi32(0x38800000);
+	const __m128 denormMagic = _mm_set1_ps(0.5f);
+	const __m128i denormBias = _mm_set1_epi32(0x3F000000);
+	const __m128i rebias = _mm_set1_epi32((int)(((uint32_t)(15 - 127) << 23) + 0xFFFu));
+	const __m128i one = _mm_set1_epi32(1);
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i x = _mm_castps_si128(_mm_loadu_ps(src + i));
+		__m128i sign = _mm_and_si128(x, signMask);
+		x = _mm_xor_si128(x, sign);
+
+		__m128i isNaN = _mm_cmpgt_epi32(x, infinity);
+		__m128i isOverflow = _mm_cmpgt_epi32(x, overflow);
+		__m128i isDenorm = _mm_cmplt_epi32(x, minNormal);
+
+		__m128i denorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(x), denormMagic)), denormBias);
+		__m128i odd = _mm_and_si128(_mm_srli_epi32(x, 13), one);
+		__m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, rebias), odd), 13);
+
+		__m128i half = _mm_or_si128(_mm_and_si128(isDenorm, denorm), _mm_andnot_si128(isDenorm, normal));
+		__m128i special = _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNaN, _mm_set1_epi32(0x0200)));
+		half = _mm_or_si128(_mm_and_si128(isOverflow, special), _mm_andnot_si128(isOverflow, half));
+		half = _mm_or_si128(half, _mm_srli_epi32(sign, 16));
+
+		// sign-extend the low 16 bits so the saturating pack keeps them unchanged
+		half = _mm_srai_epi32(_mm_slli_epi32(half, 16), 16);
+		_mm_storel_epi64((__m128i*)(dst + i), _mm_packs_epi32(half, half));
+	}
+#endif
+	for (; i < count; i++)
+		dst[i] = toHalf(src[i]);
+}
+
+void VertexFormat::toUNorm8(const float* src, uint8_t* dst, size_t count)
+{
+	size_t i = 0;
+#if defined(VERTEX_FORMAT_SSE2)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 oneF = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(255.0f);
+	for (; i + 16 <= count; i += 16)
+	{
+		// min/max also send NaN to 0, as the scalar path does
+		__m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), oneF), scale));
+		__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), zero), oneF), scale));
+		__m128i c = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 8), zero), oneF), scale));
+		__m128i d = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 12), zero), oneF), scale));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float v = src[i] > 0.0f ? (src[i] < 1.0f ? src[i] : 1.0f) : 0.0f;
+		dst[i] = (uint8_t)(int)std::nearbyint(v * 255.0f);
+	}
+}
+
+void VertexFormat::toUNorm16(const float* src, uint16_t* dst, size_t count)
+{
+	size_t i = 0;
+#if defined(VERTEX_FORMAT_SSE2)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 oneF = _mm_set1_ps(1.0f);
+	const __m128 scale = _mm_set1_ps(65535.0f);
+	const __m128i bias = _mm_set1_epi32(32768);
+	const __m128i flip = _mm_set1_epi16((short)0x8000);
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), oneF), scale));
+		__m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), zero), oneF), scale));
+		// SSE2 only has a signed 32 -> 16 pack: shift into the signed range, pack, shift back
+		__m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias), _mm_sub_epi32(b, bias));
+		_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(packed, flip));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float v = src[i] > 0.0f ? (src[i] < 1.0f ? src[i] : 1.0f) : 0.0f;
+		dst[i] = (uint16_t)(int)std::nearbyint(v * 65535.0f);
+	}
+}
+
+size_t VertexFormat::componentSize(AttributeEncoding encoding)
+{
+	switch (encoding)
+	{
+	case AttributeEncoding::HalfFloat:
+	case AttributeEncoding::UNorm16:
+		return 2;
+	case AttributeEncoding::UNorm8:
+		return 1;
+	default:
+		return 4;
+	}
+}
+
+GLenum VertexFormat::glType(AttributeEncoding encoding)
+{
+	switch (encoding)
+	{
+	case AttributeEncoding::HalfFloat:
+		return GL_HALF_FLOAT;
+	case AttributeEncoding::UNorm8:
+		return GL_UNSIGNED_BYTE;
+	case AttributeEncoding::UNorm16:
+		return GL_UNSIGNED_SHORT;
+	default:
+		return GL_FLOAT;
+	}
+}
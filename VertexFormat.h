@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// how one vertex attribute is stored in the vertex buffer
+enum class AttributeEncoding
+{
+	Float,      // 32-bit float, lossless
+	HalfFloat,  // 16-bit float: positions of meshes within +-65504, about 3 significant digits
+	UNorm8,     // 8-bit normalized [0, 1]: colors
+	UNorm16     // 16-bit normalized [0, 1]: texture coordinates that don't tile past the texture
+};
+
+// Interleaved vertex layout with compact encodings. Attributes are declared
+// in order with add(); each one starts on a 4-byte boundary, so a half3 takes
+// 8 bytes and an RGBA8 color 4. apply() describes the layout to a vertex
+// array object with glVertexArrayAttribFormat, and pack() converts float source
+// vertices (attributes interleaved in declaration order, like boxData) to it
+// with SSE2 (F16C for halves where the compiler targets it).
+//
+// The box quad's position vec3, color vec3 and texcoord vec2 go from 32 bytes
+// as floats to 16 as half3 + RGBA8 + unorm16x2.
+class VertexFormat
+{
+public:
+	struct Attribute
+	{
+		unsigned int location;
+		int components;
+		AttributeEncoding encoding;
+		size_t offset;
+	};
+
+	VertexFormat();
+
+	// append an attribute; returns *this so a format can be declared in one expression
+	VertexFormat& add(unsigned int location, int components, AttributeEncoding encoding);
+	size_t stride() const { return bytes; }
+	// floats per source vertex that pack() reads
+	size_t sourceFloats() const { return floats; }
+	const std::vector<Attribute>& attributes() const { return layout; }
+
+	// set attribute formats and enable them on vao, all reading from buffer binding point binding
+	void apply(unsigned int vao, unsigned int binding = 0) const;
+	// encode vertexCount source vertices into dst (vertexCount * stride() bytes)
+	void pack(const float* src, size_t vertexCount, unsigned char* dst) const;
+
+	// bulk converters, values are clamped to the representable range
+	static void toHalf(const float* src, uint16_t* dst, size_t count);
+	static void toUNorm8(const float* src, uint8_t* dst, size_t count);
+	static void toUNorm16(const float* src, uint16_t* dst, size_t count);
+	static uint16_t toHalf(float value);
+
+private:
+	std::vector<Attribute> layout;
+	size_t bytes;
+	size_t floats;
+
+	static size_t componentSize(AttributeEncoding encoding);
+	static GLenum glType(AttributeEncoding encoding);
+};
@@ -0,0 +1,449 @@
+#include "VirtualTexture.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+
+VirtualTexture::VirtualTexture(JobSystem& jobs, const std::string& path, const std::string& cacheDirectory,
+	int cachePages, bool flipVertically)
+	: path(path), cacheDirectory(cacheDirectory), flip(flipVertically), cachePages(cachePages), ready(false),
+	width(0), height(0), levels(0), tableWidth(0), tableHeight(0), pageTable(0), physical(0), tableDirty(false),
+	frame(0), feedbackFramebuffer(0), feedbackColor(0), feedbackDepth(0), feedbackWidth(0), feedbackHeight(0),
+	viewportWidth(0), viewportHeight(0), readbackHead(0), jobs(jobs), baked(false), failed(false), stopping(false)
+{
+	jobs.run([this] { loadSource(); }, &work);
+}
+
+void VirtualTexture::bind(Shader& shader, unsigned int pageTableUnit, unsigned int cacheUnit) const
+{
+	shader.use();
+	GLState::bindTexture(pageTableUnit, pageTable);
+	GLState::bindTexture(cacheUnit, physical);
+	shader.setInt("pageTable", pageTableUnit);
+	shader.setInt("physicalCache", cacheUnit);
+	shader.setInt("levelCount", levels);
+	shader.setFloat("cacheSize", (float)(cachePages * PAGE_SIZE));
+	shader.setFloat("feedbackBias", -std::log2((float)FEEDBACK_DIVISOR));
+	glUniform2f(glGetUniformLocation(shader.ID, "virtualSize"), (float)width, (float)height);
+	glUniform1iv(glGetUniformLocation(shader.ID, "tableOffsets"), levels, tableOffset);
+}
+
+void VirtualTexture::beginFeedback(int viewportWidth, int viewportHeight)
+{
+	this->viewportWidth = viewportWidth;
+	this->viewportHeight = viewportHeight;
+	int w = std::max(1, viewportWidth / FEEDBACK_DIVISOR), h = std::max(1, viewportHeight / FEEDBACK_DIVISOR);
+	if (w != feedbackWidth || h != feedbackHeight)
+	{
+		// (re)create the target and the readback buffers for the new size
+		if (feedbackFramebuffer)
+		{
+			glDeleteFramebuffers(1, &feedbackFramebuffer);
+			GLState::textureDeleted(feedbackColor);
+			glDeleteTextures(1, &feedbackColor);
+			glDeleteRenderbuffers(1, &feedbackDepth);
+		}
+		feedbackWidth = w;
+		feedbackHeight = h;
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &feedbackColor);
+		glTextureStorage2D(feedbackColor, 1, GL_RGBA8, w, h);
+		glCreateRenderbuffers(1, &feedbackDepth);
+		glNamedRenderbufferStorage(feedbackDepth, GL_DEPTH_COMPONENT24, w, h);
+		glCreateFramebuffers(1, &feedbackFramebuffer);
+		glNamedFramebufferTexture(feedbackFramebuffer, GL_COLOR_ATTACHMENT0, feedbackColor, 0);
+		glNamedFramebufferRenderbuffer(feedbackFramebuffer, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+		if (glCheckNamedFramebufferStatus(feedbackFramebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::VIRTUAL_TEXTURE::FEEDBACK_FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+		for (size_t i = 0; i < readbacks.size(); i++)
+		{
+			if (readbacks[i].fence)
+				glDeleteSync(readbacks[i].fence);
+			glDeleteBuffers(1, &readbacks[i].buffer);
+		}
+		// three in flight: the CPU reads feedback two frames after the GPU wrote it, without waiting
+		readbacks.assign(3, Readback());
+		for (size_t i = 0; i < readbacks.size(); i++)
+		{
+			glCreateBuffers(1, &readbacks[i].buffer);
+			glNamedBufferStorage(readbacks[i].buffer, (size_t)w * h * 4, NULL, GL_MAP_READ_BIT | GL_CLIENT_STORAGE_BIT);
+			readbacks[i].fence = 0;
+		}
+		readbackHead = 0;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+	GLState::viewport(0, 0, feedbackWidth, feedbackHeight);
+	// alpha 0 marks pixels that sampled nothing
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void VirtualTexture::endFeedback()
+{
+	Readback& readback = readbacks[readbackHead];
+	// still unread: skip this frame's feedback rather than stall on the GPU
+	if (!readback.fence)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		readbackHead = (readbackHead + 1) % readbacks.size();
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	GLState::viewport(0, 0, viewportWidth, viewportHeight);
+}
+
+void VirtualTexture::update(int uploadBudget)
+{
+	if (!levels)
+	{
+		bool done, broken;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			done = baked;
+			broken = failed;
+		}
+		if (broken)
+		{
+			std::cout << "ERROR::VIRTUAL_TEXTURE::FAILED_TO_LOAD " << path << std::endl;
+			std::lock_guard<std::mutex> lock(mutex);
+			failed = false;
+		}
+		if (!done)
+			return;
+		setupLevels();
+		if (!levels)
+			return;
+		request(pageKey(levels - 1, 0, 0));
+	}
+
+	// oldest first, stop at the first one the GPU hasn't finished
+	for (size_t n = 0; n < readbacks.size(); n++)
+	{
+		Readback& readback = readbacks[(readbackHead + n) % readbacks.size()];
+		if (!readback.fence)
+			continue;
+		GLenum status = glClientWaitSync(readback.fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(readback.fence);
+		readback.fence = 0;
+
+		size_t count = (size_t)feedbackWidth * feedbackHeight;
+		const unsigned char* pixels = (const unsigned char*)glMapNamedBufferRange(readback.buffer, 0, count * 4, GL_MAP_READ_BIT);
+		if (pixels)
+		{
+			readFeedback(pixels, count);
+			glUnmapNamedBuffer(readback.buffer);
+		}
+	}
+
+	std::deque<Tile> tiles;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int i = 0; i < uploadBudget && !loaded.empty(); i++)
+		{
+			tiles.push_back(std::move(loaded.front()));
+			loaded.pop_front();
+		}
+	}
+	if (!tiles.empty())
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		for (size_t i = 0; i < tiles.size(); i++)
+		{
+			if (!upload(tiles[i]))
+				requested.erase(tiles[i].page);
+		}
+	}
+
+	if (tableDirty)
+		rebuildTable();
+	frame++;
+}
+
+void VirtualTexture::dispose()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	// queued cuts see stopping and return right away
+	jobs.wait(work);
+
+	for (size_t i = 0; i < readbacks.size(); i++)
+	{
+		if (readbacks[i].fence)
+			glDeleteSync(readbacks[i].fence);
+		glDeleteBuffers(1, &readbacks[i].buffer);
+	}
+	readbacks.clear();
+	glDeleteFramebuffers(1, &feedbackFramebuffer);
+	GLState::textureDeleted(feedbackColor);
+	glDeleteTextures(1, &feedbackColor);
+	glDeleteRenderbuffers(1, &feedbackDepth);
+	GLState::textureDeleted(pageTable);
+	glDeleteTextures(1, &pageTable);
+	GLState::textureDeleted(physical);
+	glDeleteTextures(1, &physical);
+	feedbackFramebuffer = feedbackColor = feedbackDepth = pageTable = physical = 0;
+	source.file.close();
+}
+
+void VirtualTexture::loadSource()
+{
+	bool prepared = prepareSource();
+	std::lock_guard<std::mutex> lock(mutex);
+	baked = prepared;
+	failed = !prepared;
+}
+
+bool VirtualTexture::prepareSource()
+{
+	MappedFile file;
+	if (!file.open(path))
+		return false;
+
+	// the same entry the TextureStreamer bakes for an RGBA8 texture with a precomputed box-filtered chain
+	TextureCache cache(cacheDirectory);
+	Hash128 key = TextureCache::key(hashBytes(file.data, file.size), GL_RGBA8, MipMode::Precomputed, MipFilter::Box,
+		CompressionQuality::Normal, flip);
+	if (cache.load(key, source))
+		return true;
+
+	int w, h, channels;
+	stbi_set_flip_vertically_on_load_thread(flip);
+	unsigned char* pixels = stbi_load_from_memory(file.data, (int)file.size, &w, &h, &channels, 4);
+	file.close();
+	if (!pixels)
+		return false;
+	int chainLevels = Texture::mipLevels(w, h);
+	std::vector<unsigned char> chain(Texture::chainSize(w, h, chainLevels));
+	MipGenerator::build(pixels, w, h, chainLevels, chain.data(), MipFilter::Box, false);
+	stbi_image_free(pixels);
+
+	return cache.store(key, GL_RGBA8, MipMode::Precomputed, w, h, chainLevels, chain.data()) && cache.load(key, source);
+}
+
+void VirtualTexture::cutPage(uint32_t page)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (stopping)
+			return;
+	}
+
+	Tile tile;
+	tile.page = page;
+	cutTile(page, tile.pixels);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	loaded.push_back(std::move(tile));
+}
+
+void VirtualTexture::cutTile(uint32_t page, std::vector<unsigned char>& pixels) const
+{
+	int level = (int)(page >> 16), y = (int)((page >> 8) & 0xFF), x = (int)(page & 0xFF);
+	int w = Texture::levelDimension(width, level), h = Texture::levelDimension(height, level);
+	const unsigned char* data = source.data + source.levelTable[level].offset;
+
+	pixels.resize((size_t)PAGE_SIZE * PAGE_SIZE * 4);
+	int left = x * PAGE_CONTENT - PAGE_BORDER, bottom = y * PAGE_CONTENT - PAGE_BORDER;
+	for (int ty = 0; ty < PAGE_SIZE; ty++)
+	{
+		int sy = std::min(std::max(bottom + ty, 0), h - 1);
+		const unsigned char* row = data + (size_t)sy * w * 4;
+		unsigned char* dst = pixels.data() + (size_t)ty * PAGE_SIZE * 4;
+		for (int tx = 0; tx < PAGE_SIZE; tx++)
+		{
+			int sx = std::min(std::max(left + tx, 0), w - 1);
+			memcpy(dst + tx * 4, row + (size_t)sx * 4, 4);
+		}
+	}
+}
+
+void VirtualTexture::setupLevels()
+{
+	width = (int)source.header.width;
+	height = (int)source.header.height;
+	int available = std::min((int)source.header.levels, (int)MAX_LEVELS);
+
+	// stop at the first level that fits in one page; coarser ones would only repeat it
+	levels = 0;
+	tableWidth = 0;
+	for (int level = 0; level < available; level++)
+	{
+		pagesX[level] = (Texture::levelDimension(width, level) + PAGE_CONTENT - 1) / PAGE_CONTENT;
+		pagesY[level] = (Texture::levelDimension(height, level) + PAGE_CONTENT - 1) / PAGE_CONTENT;
+		tableOffset[level] = tableWidth;
+		tableWidth += pagesX[level];
+		levels++;
+		if (pagesX[level] == 1 && pagesY[level] == 1)
+			break;
+	}
+	tableHeight = pagesY[0];
+	if (pagesX[0] > MAX_PAGES || pagesY[0] > MAX_PAGES || pagesX[levels - 1] * pagesY[levels - 1] != 1)
+	{
+		std::cout << "ERROR::VIRTUAL_TEXTURE::IMAGE_TOO_LARGE " << width << "x" << height << std::endl;
+		levels = 0;
+		// don't set up again every frame
+		std::lock_guard<std::mutex> lock(mutex);
+		baked = false;
+		return;
+	}
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &pageTable);
+	glTextureStorage2D(pageTable, 1, GL_RGBA8UI, tableWidth, tableHeight);
+	glTextureParameteri(pageTable, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(pageTable, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	// tiles carry their own borders, so the cache is sampled bilinearly without mips
+	int cacheSize = cachePages * PAGE_SIZE;
+	glCreateTextures(GL_TEXTURE_2D, 1, &physical);
+	glTextureStorage2D(physical, 1, GL_RGBA8, cacheSize, cacheSize);
+	glTextureParameteri(physical, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(physical, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(physical, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(physical, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	Slot empty = { EMPTY, 0 };
+	slots.assign((size_t)cachePages * cachePages, empty);
+	tableData.assign((size_t)tableWidth * tableHeight * 4, 0);
+	tableDirty = true;
+}
+
+void VirtualTexture::request(uint32_t page)
+{
+	if (pageSlots.count(page) || !requested.insert(page).second)
+		return;
+	jobs.run([this, page] { cutPage(page); }, &work);
+}
+
+void VirtualTexture::readFeedback(const unsigned char* pixels, size_t count)
+{
+	std::unordered_set<uint32_t> seen;
+	for (size_t i = 0; i < count; i++)
+	{
+		const unsigned char* texel = pixels + i * 4;
+		if (texel[3] == 0 || texel[2] >= levels || texel[0] >= pagesX[texel[2]] || texel[1] >= pagesY[texel[2]])
+			continue;
+		seen.insert(pageKey(texel[2], texel[0], texel[1]));
+	}
+
+	// ancestors too, so a missing page falls back to the closest level possible
+	std::vector<uint32_t> wanted;
+	std::unordered_set<uint32_t> added;
+	for (std::unordered_set<uint32_t>::iterator it = seen.begin(); it != seen.end(); ++it)
+	{
+		int level = (int)(*it >> 16), y = (int)((*it >> 8) & 0xFF), x = (int)(*it & 0xFF);
+		for (;;)
+		{
+			uint32_t page = pageKey(level, x, y);
+			if (!added.insert(page).second)
+				break;
+			wanted.push_back(page);
+			if (level + 1 >= levels)
+				break;
+			// the parent holding the centre of this page
+			float u = (x + 0.5f) * PAGE_CONTENT / Texture::levelDimension(width, level);
+			float v = (y + 0.5f) * PAGE_CONTENT / Texture::levelDimension(height, level);
+			level++;
+			x = std::min((int)(u * Texture::levelDimension(width, level) / PAGE_CONTENT), pagesX[level] - 1);
+			y = std::min((int)(v * Texture::levelDimension(height, level) / PAGE_CONTENT), pagesY[level] - 1);
+		}
+	}
+
+	// coarse pages first: they cover the most screen and become fallbacks for the rest
+	std::sort(wanted.begin(), wanted.end(), [](uint32_t a, uint32_t b) { return a > b; });
+	for (size_t i = 0; i < wanted.size(); i++)
+	{
+		std::unordered_map<uint32_t, int>::iterator resident = pageSlots.find(wanted[i]);
+		if (resident != pageSlots.end())
+			slots[resident->second].lastUsed = frame;
+		else
+			request(wanted[i]);
+	}
+}
+
+bool VirtualTexture::upload(Tile& tile)
+{
+	uint32_t pinned = pageKey(levels - 1, 0, 0);
+	// a free slot, otherwise the least recently wanted page the last feedback didn't ask for
+	int chosen = -1;
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		if (slots[i].page == EMPTY)
+		{
+			chosen = (int)i;
+			break;
+		}
+		if (slots[i].page != pinned && slots[i].lastUsed + 1 < frame
+			&& (chosen < 0 || slots[i].lastUsed < slots[chosen].lastUsed))
+			chosen = (int)i;
+	}
+	if (chosen < 0)
+		return false;
+
+	Slot& slot = slots[chosen];
+	if (slot.page != EMPTY)
+		pageSlots.erase(slot.page);
+	slot.page = tile.page;
+	slot.lastUsed = frame;
+	pageSlots[tile.page] = chosen;
+	requested.erase(tile.page);
+
+	int slotX = chosen % cachePages, slotY = chosen / cachePages;
+	glTextureSubImage2D(physical, 0, slotX * PAGE_SIZE, slotY * PAGE_SIZE, PAGE_SIZE, PAGE_SIZE, GL_RGBA,
+		GL_UNSIGNED_BYTE, tile.pixels.data());
+	tableDirty = true;
+	if (tile.page == pinned)
+		ready = true;
+	return true;
+}
+
+void VirtualTexture::rebuildTable()
+{
+	// coarse to fine so every missing page can copy its parent's entry, which is already final
+	for (int level = levels - 1; level >= 0; level--)
+	{
+		int w = Texture::levelDimension(width, level), h = Texture::levelDimension(height, level);
+		for (int y = 0; y < pagesY[level]; y++)
+		{
+			for (int x = 0; x < pagesX[level]; x++)
+			{
+				unsigned char* entry = &tableData[((size_t)y * tableWidth + tableOffset[level] + x) * 4];
+				std::unordered_map<uint32_t, int>::iterator resident = pageSlots.find(pageKey(level, x, y));
+				if (resident != pageSlots.end())
+				{
+					entry[0] = (unsigned char)(resident->second % cachePages);
+					entry[1] = (unsigned char)(resident->second / cachePages);
+					entry[2] = (unsigned char)level;
+					entry[3] = 255;
+				}
+				else if (level + 1 < levels)
+				{
+					int parentLevel = level + 1;
+					float u = (x + 0.5f) * PAGE_CONTENT / w, v = (y + 0.5f) * PAGE_CONTENT / h;
+					int px = std::min((int)(u * Texture::levelDimension(width, parentLevel) / PAGE_CONTENT), pagesX[parentLevel] - 1);
+					int py = std::min((int)(v * Texture::levelDimension(height, parentLevel) / PAGE_CONTENT), pagesY[parentLevel] - 1);
+					memcpy(entry, &tableData[((size_t)py * tableWidth + tableOffset[parentLevel] + px) * 4], 4);
+				}
+				else
+				{
+					// only before the pinned page arrives; shaders don't sample until isReady()
+					entry[0] = entry[1] = 0;
+					entry[2] = (unsigned char)level;
+					entry[3] = 0;
+				}
+			}
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTextureSubImage2D(pageTable, 0, 0, 0, tableWidth, tableHeight, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, tableData.data());
+	tableDirty = false;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <mutex>
+#include <iostream>
+
+#include "Shader.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "ContentHash.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "JobSystem.h"
+
+// Sparse virtual texture: a large image of which only the pages the screen
+// actually samples are kept on the GPU.
+//
+// The image and its mips are cut into pages of PAGE_CONTENT texels. Resident
+// pages live in a physical cache texture as PAGE_SIZE tiles (content plus a
+// PAGE_BORDER of neighbouring texels for bilinear filtering). A page table
+// texture holds one RGBA8UI entry per page and level, all levels side by
+// side: the cache tile of the page and the level that tile belongs to. A page
+// that isn't resident points at its closest resident ancestor, so shaders
+// always find something to sample; the single page of the coarsest level is
+// pinned in the cache.
+//
+// Each frame the scene is drawn once more at 1/FEEDBACK_DIVISOR resolution
+// with BrickTextureFeedback.fs, which writes the page and level every pixel
+// wants. The result is read back through a PBO a few frames later, missing
+// pages are cut from the baked mip chain by JobSystem jobs (the source image
+// is decoded and baked to the TextureCache once) and uploaded in update(),
+// evicting the least recently requested tiles. GPU memory is the cache size,
+// independent of the image size.
+class VirtualTexture
+{
+public:
+	static const int PAGE_SIZE = 128;
+	static const int PAGE_BORDER = 4;
+	static const int PAGE_CONTENT = PAGE_SIZE - 2 * PAGE_BORDER;
+	static const int FEEDBACK_DIVISOR = 8;
+	// page coordinates travel through RGBA8 feedback, so a level holds at most 255 pages per side
+	static const int MAX_PAGES = 255;
+	static const int MAX_LEVELS = 16;
+
+	// cachePages x cachePages tiles of physical memory; the image is baked into cacheDirectory on first use
+	VirtualTexture(JobSystem& jobs, const std::string& path, const std::string& cacheDirectory, int cachePages = 32,
+		bool flipVertically = true);
+
+	// true once the image is baked and its coarsest page is resident
+	bool isReady() const { return ready; }
+	// bind the page table and physical cache and set the virtual texture uniforms of a sampling or feedback shader
+	void bind(Shader& shader, unsigned int pageTableUnit, unsigned int cacheUnit) const;
+	// render target for the feedback pass, sized for a viewport of width x height; draw with the feedback shader in between
+	void beginFeedback(int viewportWidth, int viewportHeight);
+	// queue an asynchronous readback of the feedback pass and restore the default framebuffer and viewport
+	void endFeedback();
+	// call once per frame: read finished feedback, request missing pages and upload up to uploadBudget loaded ones
+	void update(int uploadBudget = 8);
+	// pages currently resident in the physical cache
+	size_t residentPages() const { return pageSlots.size(); }
+	void dispose();
+
+private:
+	struct Slot
+	{
+		uint32_t page;      // key of the page held, or EMPTY
+		uint64_t lastUsed;  // frame the page was last requested by feedback
+	};
+
+	struct Tile
+	{
+		uint32_t page;
+		std::vector<unsigned char> pixels;  // PAGE_SIZE x PAGE_SIZE RGBA8
+	};
+
+	struct Readback
+	{
+		unsigned int buffer;
+		GLsync fence;
+	};
+
+	static const uint32_t EMPTY = 0xFFFFFFFF;
+
+	std::string path;
+	std::string cacheDirectory;
+	bool flip;
+	int cachePages;
+	bool ready;
+	int width, height, levels;
+	int pagesX[MAX_LEVELS], pagesY[MAX_LEVELS];
+	int tableOffset[MAX_LEVELS];  // x of each level in the page table
+	int tableWidth, tableHeight;
+
+	unsigned int pageTable;
+	unsigned int physical;
+	std::vector<unsigned char> tableData;
+	bool tableDirty;
+
+	std::vector<Slot> slots;
+	std::unordered_map<uint32_t, int> pageSlots;  // resident page to slot
+	std::unordered_set<uint32_t> requested;       // pages queued or being cut
+	uint64_t frame;
+
+	unsigned int feedbackFramebuffer;
+	unsigned int feedbackColor, feedbackDepth;
+	int feedbackWidth, feedbackHeight;
+	int viewportWidth, viewportHeight;
+	std::vector<Readback> readbacks;
+	size_t readbackHead;
+
+	// job state, guarded by mutex
+	JobSystem& jobs;
+	JobCounter work;  // the source job and page cuts not finished yet
+	TextureCache::Entry source;
+	std::mutex mutex;
+	std::deque<Tile> loaded;
+	bool baked;
+	bool failed;
+	bool stopping;
+
+	static uint32_t pageKey(int level, int x, int y) { return ((uint32_t)level << 16) | ((uint32_t)y << 8) | (uint32_t)x; }
+	// job: make the source available, then let update() set up the levels
+	void loadSource();
+	// decode and bake the source image, or map an earlier bake
+	bool prepareSource();
+	// job: cut one requested page and queue it for upload
+	void cutPage(uint32_t page);
+	// copy one page with its border, clamped at the image edges, out of the mapped level
+	void cutTile(uint32_t page, std::vector<unsigned char>& pixels) const;
+	void setupLevels();
+	void request(uint32_t page);
+	void readFeedback(const unsigned char* pixels, size_t count);
+	bool upload(Tile& tile);
+	void rebuildTable();
+};
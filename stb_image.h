@@ -428,6 +428,22 @@ STBIDEF stbi_uc *stbi_load_from_file  (FILE *f, int *x, int *y, int *channels_in
 
 #ifndef STBI_NO_GIF
 STBIDEF stbi_uc *stbi_load_gif_from_memory(stbi_uc const *buffer, int len, int **delays, int *x, int *y, int *z, int *comp, int req_comp);
+
+// Animated GIF frame iterator. Unlike stbi_load_gif_from_memory, which keeps
+// every frame in one allocation, this decodes one composited frame at a time
+// into a caller-owned buffer of x*y*4 bytes, so memory use does not grow with
+// the number of frames. For the _memory variant 'buffer' must stay valid until
+// stbi_gif_frames_close. stbi_gif_frames_next returns 1 when a frame was
+// written (delay_ms may be NULL), 0 at the end of the animation and -1 on a
+// decode error (see stbi_failure_reason).
+typedef struct stbi_gif_frames stbi_gif_frames;
+STBIDEF stbi_gif_frames *stbi_gif_frames_open_memory(stbi_uc const *buffer, int len, int *x, int *y);
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_gif_frames *stbi_gif_frames_open  (char const *filename, int *x, int *y);
+#endif
+STBIDEF int              stbi_gif_frames_next  (stbi_gif_frames *frames, stbi_uc *out, int *delay_ms);
+STBIDEF int              stbi_gif_frames_rewind(stbi_gif_frames *frames);
+STBIDEF void             stbi_gif_frames_close (stbi_gif_frames *frames);
 #endif
 
 #ifdef STBI_WINDOWS_UTF8
@@ -6967,6 +6983,147 @@ static void *stbi__load_gif_main(stbi__context *s, int **delays, int *x, int *y,
    }
 }
 
+struct stbi_gif_frames
+{
+   stbi__context s;
+   stbi__gif g;
+   stbi_uc const *buffer;
+   int len;
+#ifndef STBI_NO_STDIO
+   FILE *f;
+   long f_start;
+#endif
+   stbi_uc *prev, *two_back;  // composited frames n-1 and n-2, needed for "restore to previous" disposal
+   int frame;
+   int done;
+};
+
+static void stbi__gif_frames_free_state(stbi_gif_frames *it)
+{
+   STBI_FREE(it->g.out);
+   STBI_FREE(it->g.history);
+   STBI_FREE(it->g.background);
+   memset(&it->g, 0, sizeof(it->g));
+}
+
+// restart decoding from the first byte of the stream
+static int stbi__gif_frames_restart(stbi_gif_frames *it)
+{
+   stbi__gif_frames_free_state(it);
+   it->frame = 0;
+   it->done = 0;
+#ifndef STBI_NO_STDIO
+   if (it->f) {
+      if (fseek(it->f, it->f_start, SEEK_SET) != 0)
+         return stbi__err("seek failed", "Unable to rewind GIF file");
+      stbi__start_file(&it->s, it->f);
+      return 1;
+   }
+#endif
+   stbi__start_mem(&it->s, it->buffer, it->len);
+   return 1;
+}
+
+static stbi_gif_frames *stbi__gif_frames_open_main(stbi_gif_frames *it, int *x, int *y)
+{
+   int stride;
+   if (!stbi__gif_frames_restart(it) || !stbi__gif_header(&it->s, &it->g, 0, 1)) {
+      stbi_gif_frames_close(it);
+      return NULL;
+   }
+   if (!stbi__mad3sizes_valid(4, it->g.w, it->g.h, 0)) {
+      stbi_gif_frames_close(it);
+      return (stbi_gif_frames *) stbi__errpuc("too large", "GIF image is too large");
+   }
+   stride = 4 * it->g.w * it->g.h;
+   if (x) *x = it->g.w;
+   if (y) *y = it->g.h;
+   it->prev = (stbi_uc *) stbi__malloc(stride);
+   it->two_back = (stbi_uc *) stbi__malloc(stride);
+   if (!it->prev || !it->two_back || !stbi__gif_frames_restart(it)) {
+      stbi_gif_frames_close(it);
+      return (stbi_gif_frames *) stbi__errpuc("outofmem", "Out of memory");
+   }
+   return it;
+}
+
+STBIDEF stbi_gif_frames *stbi_gif_frames_open_memory(stbi_uc const *buffer, int len, int *x, int *y)
+{
+   stbi_gif_frames *it = (stbi_gif_frames *) stbi__malloc(sizeof(*it));
+   if (!it) return (stbi_gif_frames *) stbi__errpuc("outofmem", "Out of memory");
+   memset(it, 0, sizeof(*it));
+   it->buffer = buffer;
+   it->len = len;
+   return stbi__gif_frames_open_main(it, x, y);
+}
+
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_gif_frames *stbi_gif_frames_open(char const *filename, int *x, int *y)
+{
+   stbi_gif_frames *it;
+   FILE *f = stbi__fopen(filename, "rb");
+   if (!f) return (stbi_gif_frames *) stbi__errpuc("can't fopen", "Unable to open file");
+   it = (stbi_gif_frames *) stbi__malloc(sizeof(*it));
+   if (!it) {
+      fclose(f);
+      return (stbi_gif_frames *) stbi__errpuc("outofmem", "Out of memory");
+   }
+   memset(it, 0, sizeof(*it));
+   it->f = f;
+   it->f_start = ftell(f);
+   return stbi__gif_frames_open_main(it, x, y);
+}
+#endif
+
+STBIDEF int stbi_gif_frames_next(stbi_gif_frames *it, stbi_uc *out, int *delay_ms)
+{
+   stbi_uc *u, *tmp;
+   int comp, stride;
+
+   if (it->done) return 0;
+
+   u = stbi__gif_load_next(&it->s, &it->g, &comp, 4, it->frame >= 2 ? it->two_back : 0);
+   if (u == (stbi_uc *) &it->s) { // end of animated gif marker
+      it->done = 1;
+      return 0;
+   }
+   if (!u) {
+      it->done = 1;
+      return -1;
+   }
+
+   // rotate history so two_back is frame n-1 and prev is this frame
+   stride = 4 * it->g.w * it->g.h;
+   tmp = it->two_back;
+   it->two_back = it->prev;
+   it->prev = tmp;
+   memcpy(it->prev, u, stride);
+   ++it->frame;
+
+   memcpy(out, u, stride);
+   if (stbi__vertically_flip_on_load)
+      stbi__vertical_flip(out, it->g.w, it->g.h, 4);
+   if (delay_ms) *delay_ms = it->g.delay;
+   return 1;
+}
+
+STBIDEF int stbi_gif_frames_rewind(stbi_gif_frames *it)
+{
+   return stbi__gif_frames_restart(it);
+}
+
+STBIDEF void stbi_gif_frames_close(stbi_gif_frames *it)
+{
+   if (!it) return;
+   stbi__gif_frames_free_state(it);
+   STBI_FREE(it->prev);
+   STBI_FREE(it->two_back);
+#ifndef STBI_NO_STDIO
+   if (it->f) fclose(it->f);
+#endif
+   STBI_FREE(it);
+}
+
 static void *stbi__gif_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri)
 {
    stbi_uc *u = 0;